@@ -55,6 +55,17 @@ wrap_unique_ptr(CheckerUniquePtr, divvun::Checker);
 %ignore divvun::Err;
 %ignore divvun::Checker::proc_errs;
 %ignore divvun::CheckerUniquePtr::proc_errs;
+%ignore divvun::Checker::proc_errs_batch;
+%ignore divvun::CheckerUniquePtr::proc_errs_batch;
+%ignore divvun::CheckerDocument::CheckerDocument(Checker&, const std::u16string&);
+%ignore divvun::CheckerDocument::edit(size_t, size_t, const std::u16string&);
+%ignore divvun::CheckerDocument::text;
+%ignore divvun::CheckerDocument::errs;
+%newobject document_bytes;
+%feature("docstring") divvun::CheckerDocument::edit
+"Replace del units at offset with ins. Offsets count UTF-16 code units,
+like the beg and end of errors, so a character outside the BMP counts
+as two.";
 
 %include "../src/checkertypes.hpp"
 %include "../src/checker.hpp"
@@ -62,6 +73,7 @@ wrap_unique_ptr(CheckerUniquePtr, divvun::Checker);
 %template(StringVector) std::vector<std::string>;
 %template(StringSet) std::set<std::string>;
 %template(StringStringVectorMap) std::map<std::string, std::vector<std::string> >;
+%template(StageStatsVector) std::vector<divvun::StageStats>;
 
 // TODO: Would it be possible to have ErrBytes defined in
 // checkertypes.hpp? Seems like SWIG no longer understands the
@@ -109,6 +121,7 @@ wrap_unique_ptr(CheckerUniquePtr, divvun::Checker);
 %}
 
 %template(ErrBytesVector) std::vector<ErrBytes>;
+%template(ErrBytesVectorVector) std::vector<std::vector<ErrBytes> >;
 %template(ToggleIdsBytes) std::map<std::string, std::pair<std::string, std::string> >;
 %template(ToggleResBytes) std::vector<std::pair<std::string, std::pair<std::string, std::string> > >;
 %template(OptionSetBytes) std::set<OptionBytes, OptionBytesCompare>;
@@ -123,9 +136,7 @@ wrap_unique_ptr(CheckerUniquePtr, divvun::Checker);
 		return to;
 	}
 
-	const ErrBytesVector proc_errs_bytes(std::unique_ptr<divvun::Checker>& checker, const std::string& input) {
-		std::stringstream ss = std::stringstream(input);
-		const auto& errs = checker->proc_errs(ss);
+	const ErrBytesVector to_errs_bytes(const std::vector<divvun::Err>& errs) {
 		ErrBytesVector errs_bytes;
 		for(const divvun::Err& e : errs) {
 			std::vector<std::string> rep;
@@ -152,6 +163,32 @@ wrap_unique_ptr(CheckerUniquePtr, divvun::Checker);
 		return errs_bytes;
 	};
 
+	const ErrBytesVector proc_errs_bytes(std::unique_ptr<divvun::Checker>& checker, const std::string& input) {
+		std::stringstream ss = std::stringstream(input);
+		return to_errs_bytes(checker->proc_errs(ss));
+	};
+
+	const std::vector<ErrBytesVector> proc_errs_batch_bytes(std::unique_ptr<divvun::Checker>& checker, const StringVector& inputs) {
+		std::vector<ErrBytesVector> batch_bytes;
+		for(const auto& errs : checker->proc_errs_batch(inputs)) {
+			batch_bytes.push_back(to_errs_bytes(errs));
+		}
+		return batch_bytes;
+	};
+
+	// Wrapped below to keep checker alive as long as the document
+	divvun::CheckerDocument* document_bytes(std::unique_ptr<divvun::Checker>& checker, const std::string& text) {
+		return new divvun::CheckerDocument(*checker, text);
+	};
+
+	const ErrBytesVector document_errs_bytes(const divvun::CheckerDocument& doc) {
+		return to_errs_bytes(doc.errs());
+	};
+
+	const std::string document_text_bytes(const divvun::CheckerDocument& doc) {
+		return toUtf8(doc.text());
+	};
+
 	const LocalisedPrefsBytes prefs_bytes(std::unique_ptr<divvun::Checker>& checker) {
 		divvun::LocalisedPrefs prefs = checker->prefs();
 		LocalisedPrefsBytes prefs_bytes;
@@ -179,3 +216,12 @@ wrap_unique_ptr(CheckerUniquePtr, divvun::Checker);
 
 %}
 
+// The document refers to its checker, so it holds on to it here, or
+// the checker could be freed while the document still uses it:
+%pythoncode %{
+_document_bytes = document_bytes
+def document_bytes(checker, text):
+    doc = _document_bytes(checker, text)
+    doc._checker = checker
+    return doc
+%}
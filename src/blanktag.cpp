@@ -20,7 +20,7 @@
 namespace divvun {
 
 Blanktag::Blanktag(const hfst::HfstTransducer* analyser_, bool verbose)
-	: analyser(analyser_), verbose(verbose)
+	: analyser(shareTransducer(analyser_)), verbose(verbose)
 {
 	if(verbose) {
 		std::cerr << "\033[1;34m[Blanktag] Initialized with HFST transducer pointer: " << analyser_ << "\033[0m" << std::endl;
@@ -28,14 +28,14 @@ Blanktag::Blanktag(const hfst::HfstTransducer* analyser_, bool verbose)
 }
 
 Blanktag::Blanktag(const string& analyser_, bool verbose)
-	: analyser(readTransducer(analyser_)), verbose(verbose)
+	: analyser(shareTransducer(readTransducer(analyser_))), verbose(verbose)
 {
 	if(verbose) {
 		std::cerr << "\033[1;34m[Blanktag] Initialized with transducer file: '" << analyser_ << "'\033[0m" << std::endl;
 	}
 }
 
-const string Blanktag::proc(const vector<string>& preblank, const string& wf, const vector<string>& postblank, const vector<string>& readings) {
+void Blanktag::proc(const vector<string>& preblank, const string& wf, const vector<string>& postblank, const vector<string>& readings, vector<string>& out) {
 	if(verbose) {
 		std::cerr << "\033[1;32m[Blanktag::proc] Processing word form: '" << wf << "'\033[0m" << std::endl;
 		std::cerr << "\033[1;33m[Blanktag::proc] Preblank: [" << join(preblank, ", ") << "]\033[0m" << std::endl;
@@ -43,10 +43,9 @@ const string Blanktag::proc(const vector<string>& preblank, const string& wf, co
 		std::cerr << "\033[1;31m[Blanktag::proc] Readings count: " << readings.size() << "\033[0m" << std::endl;
 	}
 
-	string ret;
 	for(const auto& b : preblank) {
 		if(b != BOSMARK && b != EOSMARK) {
-			ret += ":" + b + "\n";
+			out.push_back(":" + b);
 			if(verbose) {
 				std::cerr << "\033[1;37m[Blanktag::proc] Added preblank: '" << b << "'\033[0m" << std::endl;
 			}
@@ -56,7 +55,7 @@ const string Blanktag::proc(const vector<string>& preblank, const string& wf, co
 		if(verbose) {
 			std::cerr << "\033[1;37m[Blanktag::proc] Word form is empty, returning early\033[0m" << std::endl;
 		}
-		return ret;
+		return;
 	}
 
 	const string lookup_string = join(preblank,"") + wf + join(postblank, "");
@@ -85,17 +84,17 @@ const string Blanktag::proc(const vector<string>& preblank, const string& wf, co
 	}
 	std::sort(tags.begin(), tags.end());
 
-	ret += wf + "\n";
+	out.push_back(wf);
 	for(const auto& r: readings) {
 		if(r.substr(0, 1) == ";") { // traced reading, don't touch
-			ret += r + "\n";
+			out.push_back(r);
 			if(verbose) {
 				std::cerr << "\033[1;37m[Blanktag::proc] Traced reading (unchanged): '" << r << "'\033[0m" << std::endl;
 			}
 		}
 		else {
 			string enhanced_reading = r + join(tags, "");
-			ret += enhanced_reading + "\n";
+			out.push_back(enhanced_reading);
 			if(verbose) {
 				std::cerr << "\033[1;37m[Blanktag::proc] Enhanced reading: '" << enhanced_reading << "'\033[0m" << std::endl;
 			}
@@ -105,109 +104,132 @@ const string Blanktag::proc(const vector<string>& preblank, const string& wf, co
 	if(verbose) {
 		std::cerr << "\033[1;32m[Blanktag::proc] Finished processing '" << wf << "'\033[0m" << std::endl;
 	}
-	return ret;
 }
 
-const void Blanktag::run(std::istream& is, std::ostream& os)
+Blanktag::State Blanktag::begin()
 {
+	State st;
+	st.postblank.push_back(BOSMARK); // swapped into preblank before first proc
+
 	if(verbose) {
-		std::cerr << "\033[1;34m[Blanktag::run] Starting text processing\033[0m" << std::endl;
+		std::cerr << "\033[1;34m[Blanktag::run] Initialized with BOS marker\033[0m" << std::endl;
 	}
+	return st;
+}
 
-	vector<string> preblank;
-	vector<string> postblank;
-	string wf;
-	vector<string> readings;
-	postblank.push_back(BOSMARK); // swapped into preblank before first proc
-
+bool Blanktag::step(const string& line, State& st, vector<string>& out)
+{
+	auto& preblank = st.preblank;
+	auto& postblank = st.postblank;
+	auto& wf = st.wf;
+	auto& readings = st.readings;
+	st.line_count++;
 	if(verbose) {
-		std::cerr << "\033[1;34m[Blanktag::run] Initialized with BOS marker\033[0m" << std::endl;
+		std::cerr << "\033[1;32m[Blanktag::run] Line " << st.line_count << ": '" << line << "'\033[0m" << std::endl;
+		std::cerr << "\033[1;33m[Blanktag::run] Current state - preblank: [" << join(preblank,"⮒") << "]\033[0m" << std::endl;
+		std::cerr << "\033[1;35m[Blanktag::run] Current state - postblank: [" <<join(postblank,"⮒") << "]\033[0m" << std::endl;
+		std::cerr << "\033[1;36m[Blanktag::run] Current state - wf: '" << wf << "'\033[0m" << std::endl;
+		std::cerr << "\033[1;31m[Blanktag::run] Current state - readings count: " << readings.size() << "\033[0m" << std::endl;
 	}
 
-	int line_count = 0;
-	for (string line; std::getline(is, line);) {
-		line_count++;
+	const CGLine cg = lexCGLine(line.c_str());
+
+	if (!cg.surf.empty()) {
 		if(verbose) {
-			std::cerr << "\033[1;32m[Blanktag::run] Line " << line_count << ": '" << line << "'\033[0m" << std::endl;
-			std::cerr << "\033[1;33m[Blanktag::run] Current state - preblank: [" << join(preblank,"⮒") << "]\033[0m" << std::endl;
-			std::cerr << "\033[1;35m[Blanktag::run] Current state - postblank: [" <<join(postblank,"⮒") << "]\033[0m" << std::endl;
-			std::cerr << "\033[1;36m[Blanktag::run] Current state - wf: '" << wf << "'\033[0m" << std::endl;
-			std::cerr << "\033[1;31m[Blanktag::run] Current state - readings count: " << readings.size() << "\033[0m" << std::endl;
+			std::cerr << "\033[1;32m[Blanktag::run] Detected WORD FORM: '" << cg.surf << "'\033[0m" << std::endl;
 		}
-
-		std::match_results<const char*> result;
-		std::regex_match(line.c_str(), result, CG_LINE);
-
-		if (!result.empty() && result[2].length() != 0) {
-			if(verbose) {
-				std::cerr << "\033[1;32m[Blanktag::run] Detected WORD FORM: '" << result[2] << "'\033[0m" << std::endl;
-			}
-			os << proc(preblank, wf, postblank, readings);
-			preblank.swap(postblank);
-			wf = result[1];
-			readings = {};
-			postblank = {};
-			if(verbose) {
-				std::cerr << "\033[1;37m[Blanktag::run] State reset for new word form\033[0m" << std::endl;
-			}
+		proc(preblank, wf, postblank, readings, out);
+		preblank.swap(postblank);
+		wf = cg.all;
+		readings = {};
+		postblank = {};
+		if(verbose) {
+			std::cerr << "\033[1;37m[Blanktag::run] State reset for new word form\033[0m" << std::endl;
 		}
-		else if (!result.empty() && (result[3].length() != 0 || result[8].length() != 0)) {
-			readings.push_back(line);
-			if(verbose) {
-				if(result[8].length() != 0) {
-					std::cerr << "\033[1;32m[Blanktag::run] Detected TRACED READING: '" << line << "'\033[0m" << std::endl;
-				} else {
-					std::cerr << "\033[1;32m[Blanktag::run] Detected READING: '" << line << "'\033[0m" << std::endl;
-				}
+	}
+	else if (!cg.subs.empty() || !cg.trace.empty()) {
+		readings.push_back(line);
+		if(verbose) {
+			if(!cg.trace.empty()) {
+				std::cerr << "\033[1;32m[Blanktag::run] Detected TRACED READING: '" << line << "'\033[0m" << std::endl;
+			} else {
+				std::cerr << "\033[1;32m[Blanktag::run] Detected READING: '" << line << "'\033[0m" << std::endl;
 			}
 		}
-		else if(!result.empty() && result[7].length() != 0) { // flush
-			if(verbose) {
-				std::cerr << "\033[1;32m[Blanktag::run] Detected FLUSH command\033[0m" << std::endl;
-			}
-			// TODO: Can we ever get a flush in the middle of readings?
-			os << proc(preblank, wf, postblank, readings);
-			preblank.swap(postblank);
-			wf = "";
-			readings = {};
-			postblank = {};
-			os << proc(preblank, wf, postblank, readings);
-			preblank = {};
-			os << line << std::endl;
-			os.flush();
-			if(verbose) {
-				std::cerr << "\033[1;37m[Blanktag::run] Executed flush and reset state\033[0m" << std::endl;
-			}
+	}
+	else if(cg.type == CGLine::Flush) {
+		if(verbose) {
+			std::cerr << "\033[1;32m[Blanktag::run] Detected FLUSH command\033[0m" << std::endl;
 		}
-		else if(!result.empty() && result[6].length() != 0) {
-			postblank.push_back(result[6]);
-			if(verbose) {
-				std::cerr << "\033[1;32m[Blanktag::run] Detected BLANK: '" << result[6] << "'\033[0m" << std::endl;
-			}
+		// TODO: Can we ever get a flush in the middle of readings?
+		proc(preblank, wf, postblank, readings, out);
+		preblank.swap(postblank);
+		wf = "";
+		readings = {};
+		postblank = {};
+		proc(preblank, wf, postblank, readings, out);
+		preblank = {};
+		out.push_back(line);
+		if(verbose) {
+			std::cerr << "\033[1;37m[Blanktag::run] Executed flush and reset state\033[0m" << std::endl;
 		}
-		else {
-			// don't match on blanks not prefixed by ':'
-			os << line << "\n";
-			if(verbose) {
-				std::cerr << "\033[1;32m[Blanktag::run] Detected UNMATCHED LINE (pass-through): '" << line << "'\033[0m" << std::endl;
-			}
+		return true;
+	}
+	else if(!cg.blank.empty()) {
+		postblank.push_back(string(cg.blank));
+		if(verbose) {
+			std::cerr << "\033[1;32m[Blanktag::run] Detected BLANK: '" << cg.blank << "'\033[0m" << std::endl;
+		}
+	}
+	else {
+		// don't match on blanks not prefixed by ':'
+		out.push_back(line);
+		if(verbose) {
+			std::cerr << "\033[1;32m[Blanktag::run] Detected UNMATCHED LINE (pass-through): '" << line << "'\033[0m" << std::endl;
 		}
 	}
+	return false;
+}
 
+void Blanktag::finish(State& st, vector<string>& out)
+{
 	if(verbose) {
 		std::cerr << "\033[1;34m[Blanktag::run] Reached end of input, processing final tokens\033[0m" << std::endl;
 	}
 
-	postblank.push_back(EOSMARK);
-	os << proc(preblank, wf, postblank, readings);
-	preblank.swap(postblank);
-	wf = "";
-	readings = {};
-	postblank = {};
-	os << proc(preblank, wf, postblank, readings);
+	st.postblank.push_back(EOSMARK);
+	proc(st.preblank, st.wf, st.postblank, st.readings, out);
+	st.preblank.swap(st.postblank);
+	st.wf = "";
+	st.readings = {};
+	st.postblank = {};
+	proc(st.preblank, st.wf, st.postblank, st.readings, out);
 
 	if(verbose) {
-		std::cerr << "\033[1;34m[Blanktag::run] Finished processing " << line_count << " lines\033[0m" << std::endl;
+		std::cerr << "\033[1;34m[Blanktag::run] Finished processing " << st.line_count << " lines\033[0m" << std::endl;
+	}
+}
+
+const void Blanktag::run(std::istream& is, std::ostream& os)
+{
+	if(verbose) {
+		std::cerr << "\033[1;34m[Blanktag::run] Starting text processing\033[0m" << std::endl;
+	}
+	State st = begin();
+	vector<string> out;
+	for (string line; std::getline(is, line);) {
+		const bool flush = step(line, st, out);
+		for (const auto& o : out) {
+			os << o << "\n";
+		}
+		out.clear();
+		if (flush) {
+			os.flush();
+		}
+	}
+	finish(st, out);
+	for (const auto& o : out) {
+		os << o << "\n";
 	}
 }
 
@@ -47,10 +47,23 @@ class Blanktag {
 		Blanktag(const hfst::HfstTransducer* analyser, bool verbose);
 		Blanktag(const string& analyser, bool verbose);
 		const void run(std::istream& is, std::ostream& os);
+		void setWorkers(size_t workers) { divvun::setWorkers(analyser, workers); }
 	private:
-		unique_ptr<const hfst::HfstTransducer> analyser;
+		std::shared_ptr<const SharedTransducer> analyser;
 		bool verbose;
-		const string proc(const vector<string>& preblank, const string& wf, const vector<string>& postblank, const vector<string>& readings);
+		struct State {
+			vector<string> preblank;
+			vector<string> postblank;
+			string wf;
+			vector<string> readings;
+			int line_count = 0;
+		};
+		State begin();
+		// Handle one input line, appending any output lines to out;
+		// returns true if the line was a flush
+		bool step(const string& line, State& st, vector<string>& out);
+		void finish(State& st, vector<string>& out);
+		void proc(const vector<string>& preblank, const string& wf, const vector<string>& postblank, const vector<string>& readings, vector<string>& out);
 		const string BOSMARK = "__DIVVUN_BOS__";
 		const string EOSMARK = "__DIVVUN_EOS__";
 };
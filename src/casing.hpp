@@ -0,0 +1,451 @@
+/*
+* Copyright (C) 2026, Kevin Brubeck Unhammer <unhammer@fsfe.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Unicode upper/lower-casing of UTF-8 and UTF-16 strings, without
+// locales
+
+
+#pragma once
+#ifndef a4d70e2c9b3f5816_CASING_H
+#	define a4d70e2c9b3f5816_CASING_H
+
+#	include <algorithm>
+#	include <cstdint>
+#	include <string>
+
+namespace divvun {
+
+namespace casing {
+
+// Code points first, first+stride, …, last map to code point + delta
+struct Mapping {
+	char32_t first;
+	char32_t last;
+	int32_t delta;
+	uint8_t stride;
+};
+
+struct Range {
+	char32_t first;
+	char32_t last;
+};
+
+// The tables below are the simple case mappings and character
+// classes of towupper/towlower/iswupper/iswlower in glibc 2.36's
+// C.UTF-8 locale (which are the same in every UTF-8 locale except
+// Turkish and Azerbaijani), for code points above ASCII.
+
+inline constexpr Mapping TO_UPPER[] = {
+	{0x00B5, 0x00B5, 743, 1}, {0x00E0, 0x00F6, -32, 1}, {0x00F8, 0x00FE, -32, 1},
+	{0x00FF, 0x00FF, 121, 1}, {0x0101, 0x012F, -1, 2}, {0x0131, 0x0131, -232, 1},
+	{0x0133, 0x0137, -1, 2}, {0x013A, 0x0148, -1, 2}, {0x014B, 0x0177, -1, 2},
+	{0x017A, 0x017E, -1, 2}, {0x017F, 0x017F, -300, 1}, {0x0180, 0x0180, 195, 1},
+	{0x0183, 0x0185, -1, 2}, {0x0188, 0x0188, -1, 1}, {0x018C, 0x018C, -1, 1},
+	{0x0192, 0x0192, -1, 1}, {0x0195, 0x0195, 97, 1}, {0x0199, 0x0199, -1, 1},
+	{0x019A, 0x019A, 163, 1}, {0x019E, 0x019E, 130, 1}, {0x01A1, 0x01A5, -1, 2},
+	{0x01A8, 0x01A8, -1, 1}, {0x01AD, 0x01AD, -1, 1}, {0x01B0, 0x01B0, -1, 1},
+	{0x01B4, 0x01B6, -1, 2}, {0x01B9, 0x01B9, -1, 1}, {0x01BD, 0x01BD, -1, 1},
+	{0x01BF, 0x01BF, 56, 1}, {0x01C5, 0x01C5, -1, 1}, {0x01C6, 0x01C6, -2, 1},
+	{0x01C8, 0x01C8, -1, 1}, {0x01C9, 0x01C9, -2, 1}, {0x01CB, 0x01CB, -1, 1},
+	{0x01CC, 0x01CC, -2, 1}, {0x01CE, 0x01DC, -1, 2}, {0x01DD, 0x01DD, -79, 1},
+	{0x01DF, 0x01EF, -1, 2}, {0x01F2, 0x01F2, -1, 1}, {0x01F3, 0x01F3, -2, 1},
+	{0x01F5, 0x01F5, -1, 1}, {0x01F9, 0x021F, -1, 2}, {0x0223, 0x0233, -1, 2},
+	{0x023C, 0x023C, -1, 1}, {0x023F, 0x0240, 10815, 1}, {0x0242, 0x0242, -1, 1},
+	{0x0247, 0x024F, -1, 2}, {0x0250, 0x0250, 10783, 1}, {0x0251, 0x0251, 10780, 1},
+	{0x0252, 0x0252, 10782, 1}, {0x0253, 0x0253, -210, 1}, {0x0254, 0x0254, -206, 1},
+	{0x0256, 0x0257, -205, 1}, {0x0259, 0x0259, -202, 1}, {0x025B, 0x025B, -203, 1},
+	{0x025C, 0x025C, 42319, 1}, {0x0260, 0x0260, -205, 1}, {0x0261, 0x0261, 42315, 1},
+	{0x0263, 0x0263, -207, 1}, {0x0265, 0x0265, 42280, 1}, {0x0266, 0x0266, 42308, 1},
+	{0x0268, 0x0268, -209, 1}, {0x0269, 0x0269, -211, 1}, {0x026A, 0x026A, 42308, 1},
+	{0x026B, 0x026B, 10743, 1}, {0x026C, 0x026C, 42305, 1}, {0x026F, 0x026F, -211, 1},
+	{0x0271, 0x0271, 10749, 1}, {0x0272, 0x0272, -213, 1}, {0x0275, 0x0275, -214, 1},
+	{0x027D, 0x027D, 10727, 1}, {0x0280, 0x0280, -218, 1}, {0x0282, 0x0282, 42307, 1},
+	{0x0283, 0x0283, -218, 1}, {0x0287, 0x0287, 42282, 1}, {0x0288, 0x0288, -218, 1},
+	{0x0289, 0x0289, -69, 1}, {0x028A, 0x028B, -217, 1}, {0x028C, 0x028C, -71, 1},
+	{0x0292, 0x0292, -219, 1}, {0x029D, 0x029D, 42261, 1}, {0x029E, 0x029E, 42258, 1},
+	{0x0345, 0x0345, 84, 1}, {0x0371, 0x0373, -1, 2}, {0x0377, 0x0377, -1, 1},
+	{0x037B, 0x037D, 130, 1}, {0x03AC, 0x03AC, -38, 1}, {0x03AD, 0x03AF, -37, 1},
+	{0x03B1, 0x03C1, -32, 1}, {0x03C2, 0x03C2, -31, 1}, {0x03C3, 0x03CB, -32, 1},
+	{0x03CC, 0x03CC, -64, 1}, {0x03CD, 0x03CE, -63, 1}, {0x03D0, 0x03D0, -62, 1},
+	{0x03D1, 0x03D1, -57, 1}, {0x03D5, 0x03D5, -47, 1}, {0x03D6, 0x03D6, -54, 1},
+	{0x03D7, 0x03D7, -8, 1}, {0x03D9, 0x03EF, -1, 2}, {0x03F0, 0x03F0, -86, 1},
+	{0x03F1, 0x03F1, -80, 1}, {0x03F2, 0x03F2, 7, 1}, {0x03F3, 0x03F3, -116, 1},
+	{0x03F5, 0x03F5, -96, 1}, {0x03F8, 0x03F8, -1, 1}, {0x03FB, 0x03FB, -1, 1},
+	{0x0430, 0x044F, -32, 1}, {0x0450, 0x045F, -80, 1}, {0x0461, 0x0481, -1, 2},
+	{0x048B, 0x04BF, -1, 2}, {0x04C2, 0x04CE, -1, 2}, {0x04CF, 0x04CF, -15, 1},
+	{0x04D1, 0x052F, -1, 2}, {0x0561, 0x0586, -48, 1}, {0x10D0, 0x10FA, 3008, 1},
+	{0x10FD, 0x10FF, 3008, 1}, {0x13F8, 0x13FD, -8, 1}, {0x1C80, 0x1C80, -6254, 1},
+	{0x1C81, 0x1C81, -6253, 1}, {0x1C82, 0x1C82, -6244, 1}, {0x1C83, 0x1C84, -6242, 1},
+	{0x1C85, 0x1C85, -6243, 1}, {0x1C86, 0x1C86, -6236, 1}, {0x1C87, 0x1C87, -6181, 1},
+	{0x1C88, 0x1C88, 35266, 1}, {0x1D79, 0x1D79, 35332, 1}, {0x1D7D, 0x1D7D, 3814, 1},
+	{0x1D8E, 0x1D8E, 35384, 1}, {0x1E01, 0x1E95, -1, 2}, {0x1E9B, 0x1E9B, -59, 1},
+	{0x1EA1, 0x1EFF, -1, 2}, {0x1F00, 0x1F07, 8, 1}, {0x1F10, 0x1F15, 8, 1},
+	{0x1F20, 0x1F27, 8, 1}, {0x1F30, 0x1F37, 8, 1}, {0x1F40, 0x1F45, 8, 1},
+	{0x1F51, 0x1F57, 8, 2}, {0x1F60, 0x1F67, 8, 1}, {0x1F70, 0x1F71, 74, 1},
+	{0x1F72, 0x1F75, 86, 1}, {0x1F76, 0x1F77, 100, 1}, {0x1F78, 0x1F79, 128, 1},
+	{0x1F7A, 0x1F7B, 112, 1}, {0x1F7C, 0x1F7D, 126, 1}, {0x1F80, 0x1F87, 8, 1},
+	{0x1F90, 0x1F97, 8, 1}, {0x1FA0, 0x1FA7, 8, 1}, {0x1FB0, 0x1FB1, 8, 1},
+	{0x1FB3, 0x1FB3, 9, 1}, {0x1FBE, 0x1FBE, -7205, 1}, {0x1FC3, 0x1FC3, 9, 1},
+	{0x1FD0, 0x1FD1, 8, 1}, {0x1FE0, 0x1FE1, 8, 1}, {0x1FE5, 0x1FE5, 7, 1},
+	{0x1FF3, 0x1FF3, 9, 1}, {0x214E, 0x214E, -28, 1}, {0x2170, 0x217F, -16, 1},
+	{0x2184, 0x2184, -1, 1}, {0x24D0, 0x24E9, -26, 1}, {0x2C30, 0x2C5F, -48, 1},
+	{0x2C61, 0x2C61, -1, 1}, {0x2C65, 0x2C65, -10795, 1}, {0x2C66, 0x2C66, -10792, 1},
+	{0x2C68, 0x2C6C, -1, 2}, {0x2C73, 0x2C73, -1, 1}, {0x2C76, 0x2C76, -1, 1},
+	{0x2C81, 0x2CE3, -1, 2}, {0x2CEC, 0x2CEE, -1, 2}, {0x2CF3, 0x2CF3, -1, 1},
+	{0x2D00, 0x2D25, -7264, 1}, {0x2D27, 0x2D27, -7264, 1}, {0x2D2D, 0x2D2D, -7264, 1},
+	{0xA641, 0xA66D, -1, 2}, {0xA681, 0xA69B, -1, 2}, {0xA723, 0xA72F, -1, 2},
+	{0xA733, 0xA76F, -1, 2}, {0xA77A, 0xA77C, -1, 2}, {0xA77F, 0xA787, -1, 2},
+	{0xA78C, 0xA78C, -1, 1}, {0xA791, 0xA793, -1, 2}, {0xA794, 0xA794, 48, 1},
+	{0xA797, 0xA7A9, -1, 2}, {0xA7B5, 0xA7C3, -1, 2}, {0xA7C8, 0xA7CA, -1, 2},
+	{0xA7D1, 0xA7D1, -1, 1}, {0xA7D7, 0xA7D9, -1, 2}, {0xA7F6, 0xA7F6, -1, 1},
+	{0xAB53, 0xAB53, -928, 1}, {0xAB70, 0xABBF, -38864, 1}, {0xFF41, 0xFF5A, -32, 1},
+	{0x10428, 0x1044F, -40, 1}, {0x104D8, 0x104FB, -40, 1}, {0x10597, 0x105A1, -39, 1},
+	{0x105A3, 0x105B1, -39, 1}, {0x105B3, 0x105B9, -39, 1}, {0x105BB, 0x105BC, -39, 1},
+	{0x10CC0, 0x10CF2, -64, 1}, {0x118C0, 0x118DF, -32, 1}, {0x16E60, 0x16E7F, -32, 1},
+	{0x1E922, 0x1E943, -34, 1},
+};
+
+inline constexpr Mapping TO_LOWER[] = {
+	{0x00C0, 0x00D6, 32, 1}, {0x00D8, 0x00DE, 32, 1}, {0x0100, 0x012E, 1, 2},
+	{0x0130, 0x0130, -199, 1}, {0x0132, 0x0136, 1, 2}, {0x0139, 0x0147, 1, 2},
+	{0x014A, 0x0176, 1, 2}, {0x0178, 0x0178, -121, 1}, {0x0179, 0x017D, 1, 2},
+	{0x0181, 0x0181, 210, 1}, {0x0182, 0x0184, 1, 2}, {0x0186, 0x0186, 206, 1},
+	{0x0187, 0x0187, 1, 1}, {0x0189, 0x018A, 205, 1}, {0x018B, 0x018B, 1, 1},
+	{0x018E, 0x018E, 79, 1}, {0x018F, 0x018F, 202, 1}, {0x0190, 0x0190, 203, 1},
+	{0x0191, 0x0191, 1, 1}, {0x0193, 0x0193, 205, 1}, {0x0194, 0x0194, 207, 1},
+	{0x0196, 0x0196, 211, 1}, {0x0197, 0x0197, 209, 1}, {0x0198, 0x0198, 1, 1},
+	{0x019C, 0x019C, 211, 1}, {0x019D, 0x019D, 213, 1}, {0x019F, 0x019F, 214, 1},
+	{0x01A0, 0x01A4, 1, 2}, {0x01A6, 0x01A6, 218, 1}, {0x01A7, 0x01A7, 1, 1},
+	{0x01A9, 0x01A9, 218, 1}, {0x01AC, 0x01AC, 1, 1}, {0x01AE, 0x01AE, 218, 1},
+	{0x01AF, 0x01AF, 1, 1}, {0x01B1, 0x01B2, 217, 1}, {0x01B3, 0x01B5, 1, 2},
+	{0x01B7, 0x01B7, 219, 1}, {0x01B8, 0x01B8, 1, 1}, {0x01BC, 0x01BC, 1, 1},
+	{0x01C4, 0x01C4, 2, 1}, {0x01C5, 0x01C5, 1, 1}, {0x01C7, 0x01C7, 2, 1},
+	{0x01C8, 0x01C8, 1, 1}, {0x01CA, 0x01CA, 2, 1}, {0x01CB, 0x01DB, 1, 2},
+	{0x01DE, 0x01EE, 1, 2}, {0x01F1, 0x01F1, 2, 1}, {0x01F2, 0x01F4, 1, 2},
+	{0x01F6, 0x01F6, -97, 1}, {0x01F7, 0x01F7, -56, 1}, {0x01F8, 0x021E, 1, 2},
+	{0x0220, 0x0220, -130, 1}, {0x0222, 0x0232, 1, 2}, {0x023A, 0x023A, 10795, 1},
+	{0x023B, 0x023B, 1, 1}, {0x023D, 0x023D, -163, 1}, {0x023E, 0x023E, 10792, 1},
+	{0x0241, 0x0241, 1, 1}, {0x0243, 0x0243, -195, 1}, {0x0244, 0x0244, 69, 1},
+	{0x0245, 0x0245, 71, 1}, {0x0246, 0x024E, 1, 2}, {0x0370, 0x0372, 1, 2},
+	{0x0376, 0x0376, 1, 1}, {0x037F, 0x037F, 116, 1}, {0x0386, 0x0386, 38, 1},
+	{0x0388, 0x038A, 37, 1}, {0x038C, 0x038C, 64, 1}, {0x038E, 0x038F, 63, 1},
+	{0x0391, 0x03A1, 32, 1}, {0x03A3, 0x03AB, 32, 1}, {0x03CF, 0x03CF, 8, 1},
+	{0x03D8, 0x03EE, 1, 2}, {0x03F4, 0x03F4, -60, 1}, {0x03F7, 0x03F7, 1, 1},
+	{0x03F9, 0x03F9, -7, 1}, {0x03FA, 0x03FA, 1, 1}, {0x03FD, 0x03FF, -130, 1},
+	{0x0400, 0x040F, 80, 1}, {0x0410, 0x042F, 32, 1}, {0x0460, 0x0480, 1, 2},
+	{0x048A, 0x04BE, 1, 2}, {0x04C0, 0x04C0, 15, 1}, {0x04C1, 0x04CD, 1, 2},
+	{0x04D0, 0x052E, 1, 2}, {0x0531, 0x0556, 48, 1}, {0x10A0, 0x10C5, 7264, 1},
+	{0x10C7, 0x10C7, 7264, 1}, {0x10CD, 0x10CD, 7264, 1}, {0x13A0, 0x13EF, 38864, 1},
+	{0x13F0, 0x13F5, 8, 1}, {0x1C90, 0x1CBA, -3008, 1}, {0x1CBD, 0x1CBF, -3008, 1},
+	{0x1E00, 0x1E94, 1, 2}, {0x1E9E, 0x1E9E, -7615, 1}, {0x1EA0, 0x1EFE, 1, 2},
+	{0x1F08, 0x1F0F, -8, 1}, {0x1F18, 0x1F1D, -8, 1}, {0x1F28, 0x1F2F, -8, 1},
+	{0x1F38, 0x1F3F, -8, 1}, {0x1F48, 0x1F4D, -8, 1}, {0x1F59, 0x1F5F, -8, 2},
+	{0x1F68, 0x1F6F, -8, 1}, {0x1F88, 0x1F8F, -8, 1}, {0x1F98, 0x1F9F, -8, 1},
+	{0x1FA8, 0x1FAF, -8, 1}, {0x1FB8, 0x1FB9, -8, 1}, {0x1FBA, 0x1FBB, -74, 1},
+	{0x1FBC, 0x1FBC, -9, 1}, {0x1FC8, 0x1FCB, -86, 1}, {0x1FCC, 0x1FCC, -9, 1},
+	{0x1FD8, 0x1FD9, -8, 1}, {0x1FDA, 0x1FDB, -100, 1}, {0x1FE8, 0x1FE9, -8, 1},
+	{0x1FEA, 0x1FEB, -112, 1}, {0x1FEC, 0x1FEC, -7, 1}, {0x1FF8, 0x1FF9, -128, 1},
+	{0x1FFA, 0x1FFB, -126, 1}, {0x1FFC, 0x1FFC, -9, 1}, {0x2126, 0x2126, -7517, 1},
+	{0x212A, 0x212A, -8383, 1}, {0x212B, 0x212B, -8262, 1}, {0x2132, 0x2132, 28, 1},
+	{0x2160, 0x216F, 16, 1}, {0x2183, 0x2183, 1, 1}, {0x24B6, 0x24CF, 26, 1},
+	{0x2C00, 0x2C2F, 48, 1}, {0x2C60, 0x2C60, 1, 1}, {0x2C62, 0x2C62, -10743, 1},
+	{0x2C63, 0x2C63, -3814, 1}, {0x2C64, 0x2C64, -10727, 1}, {0x2C67, 0x2C6B, 1, 2},
+	{0x2C6D, 0x2C6D, -10780, 1}, {0x2C6E, 0x2C6E, -10749, 1}, {0x2C6F, 0x2C6F, -10783, 1},
+	{0x2C70, 0x2C70, -10782, 1}, {0x2C72, 0x2C72, 1, 1}, {0x2C75, 0x2C75, 1, 1},
+	{0x2C7E, 0x2C7F, -10815, 1}, {0x2C80, 0x2CE2, 1, 2}, {0x2CEB, 0x2CED, 1, 2},
+	{0x2CF2, 0x2CF2, 1, 1}, {0xA640, 0xA66C, 1, 2}, {0xA680, 0xA69A, 1, 2},
+	{0xA722, 0xA72E, 1, 2}, {0xA732, 0xA76E, 1, 2}, {0xA779, 0xA77B, 1, 2},
+	{0xA77D, 0xA77D, -35332, 1}, {0xA77E, 0xA786, 1, 2}, {0xA78B, 0xA78B, 1, 1},
+	{0xA78D, 0xA78D, -42280, 1}, {0xA790, 0xA792, 1, 2}, {0xA796, 0xA7A8, 1, 2},
+	{0xA7AA, 0xA7AA, -42308, 1}, {0xA7AB, 0xA7AB, -42319, 1}, {0xA7AC, 0xA7AC, -42315, 1},
+	{0xA7AD, 0xA7AD, -42305, 1}, {0xA7AE, 0xA7AE, -42308, 1}, {0xA7B0, 0xA7B0, -42258, 1},
+	{0xA7B1, 0xA7B1, -42282, 1}, {0xA7B2, 0xA7B2, -42261, 1}, {0xA7B3, 0xA7B3, 928, 1},
+	{0xA7B4, 0xA7C2, 1, 2}, {0xA7C4, 0xA7C4, -48, 1}, {0xA7C5, 0xA7C5, -42307, 1},
+	{0xA7C6, 0xA7C6, -35384, 1}, {0xA7C7, 0xA7C9, 1, 2}, {0xA7D0, 0xA7D0, 1, 1},
+	{0xA7D6, 0xA7D8, 1, 2}, {0xA7F5, 0xA7F5, 1, 1}, {0xFF21, 0xFF3A, 32, 1},
+	{0x10400, 0x10427, 40, 1}, {0x104B0, 0x104D3, 40, 1}, {0x10570, 0x1057A, 39, 1},
+	{0x1057C, 0x1058A, 39, 1}, {0x1058C, 0x10592, 39, 1}, {0x10594, 0x10595, 39, 1},
+	{0x10C80, 0x10CB2, 64, 1}, {0x118A0, 0x118BF, 32, 1}, {0x16E40, 0x16E5F, 32, 1},
+	{0x1E900, 0x1E921, 34, 1},
+};
+
+// Upper-case letters without a lower-case mapping
+inline constexpr Range UPPER_UNMAPPED[] = {
+	{0x03D2, 0x03D4}, {0x2102, 0x2102}, {0x2107, 0x2107}, {0x210B, 0x210D},
+	{0x2110, 0x2112}, {0x2115, 0x2115}, {0x2119, 0x211D}, {0x2124, 0x2124},
+	{0x2128, 0x2128}, {0x212C, 0x212D}, {0x2130, 0x2131}, {0x2133, 0x2133},
+	{0x213E, 0x213F}, {0x2145, 0x2145}, {0x1D400, 0x1D419}, {0x1D434, 0x1D44D},
+	{0x1D468, 0x1D481}, {0x1D49C, 0x1D49C}, {0x1D49E, 0x1D49F}, {0x1D4A2, 0x1D4A2},
+	{0x1D4A5, 0x1D4A6}, {0x1D4A9, 0x1D4AC}, {0x1D4AE, 0x1D4B5}, {0x1D4D0, 0x1D4E9},
+	{0x1D504, 0x1D505}, {0x1D507, 0x1D50A}, {0x1D50D, 0x1D514}, {0x1D516, 0x1D51C},
+	{0x1D538, 0x1D539}, {0x1D53B, 0x1D53E}, {0x1D540, 0x1D544}, {0x1D546, 0x1D546},
+	{0x1D54A, 0x1D550}, {0x1D56C, 0x1D585}, {0x1D5A0, 0x1D5B9}, {0x1D5D4, 0x1D5ED},
+	{0x1D608, 0x1D621}, {0x1D63C, 0x1D655}, {0x1D670, 0x1D689}, {0x1D6A8, 0x1D6C0},
+	{0x1D6E2, 0x1D6FA}, {0x1D71C, 0x1D734}, {0x1D756, 0x1D76E}, {0x1D790, 0x1D7A8},
+	{0x1D7CA, 0x1D7CA}, {0x1F130, 0x1F149}, {0x1F150, 0x1F169}, {0x1F170, 0x1F189},
+};
+
+// Lower-case letters without an upper-case mapping
+inline constexpr Range LOWER_UNMAPPED[] = {
+	{0x00AA, 0x00AA}, {0x00BA, 0x00BA}, {0x00DF, 0x00DF}, {0x0138, 0x0138},
+	{0x0149, 0x0149}, {0x018D, 0x018D}, {0x019B, 0x019B}, {0x01AA, 0x01AB},
+	{0x01BA, 0x01BA}, {0x01BE, 0x01BE}, {0x01F0, 0x01F0}, {0x0221, 0x0221},
+	{0x0234, 0x0239}, {0x0255, 0x0255}, {0x0258, 0x0258}, {0x025A, 0x025A},
+	{0x025D, 0x025F}, {0x0262, 0x0262}, {0x0264, 0x0264}, {0x0267, 0x0267},
+	{0x026D, 0x026E}, {0x0270, 0x0270}, {0x0273, 0x0274}, {0x0276, 0x027C},
+	{0x027E, 0x027F}, {0x0281, 0x0281}, {0x0284, 0x0286}, {0x028D, 0x0291},
+	{0x0293, 0x0293}, {0x0295, 0x029C}, {0x029F, 0x02B8}, {0x02C0, 0x02C1},
+	{0x02E0, 0x02E4}, {0x037A, 0x037A}, {0x0390, 0x0390}, {0x03B0, 0x03B0},
+	{0x03FC, 0x03FC}, {0x0560, 0x0560}, {0x0587, 0x0588}, {0x1D00, 0x1D78},
+	{0x1D7A, 0x1D7C}, {0x1D7E, 0x1D8D}, {0x1D8F, 0x1DBF}, {0x1E96, 0x1E9A},
+	{0x1E9C, 0x1E9D}, {0x1E9F, 0x1E9F}, {0x1F50, 0x1F50}, {0x1F52, 0x1F52},
+	{0x1F54, 0x1F54}, {0x1F56, 0x1F56}, {0x1FB2, 0x1FB2}, {0x1FB4, 0x1FB4},
+	{0x1FB6, 0x1FB7}, {0x1FC2, 0x1FC2}, {0x1FC4, 0x1FC4}, {0x1FC6, 0x1FC7},
+	{0x1FD2, 0x1FD3}, {0x1FD6, 0x1FD7}, {0x1FE2, 0x1FE4}, {0x1FE6, 0x1FE7},
+	{0x1FF2, 0x1FF2}, {0x1FF4, 0x1FF4}, {0x1FF6, 0x1FF7}, {0x2071, 0x2071},
+	{0x207F, 0x207F}, {0x2090, 0x209C}, {0x210A, 0x210A}, {0x210E, 0x210F},
+	{0x2113, 0x2113}, {0x212F, 0x212F}, {0x2134, 0x2134}, {0x2139, 0x2139},
+	{0x213C, 0x213D}, {0x2146, 0x2149}, {0x2C71, 0x2C71}, {0x2C74, 0x2C74},
+	{0x2C77, 0x2C7D}, {0x2CE4, 0x2CE4}, {0xA69C, 0xA69D}, {0xA730, 0xA731},
+	{0xA770, 0xA778}, {0xA78E, 0xA78E}, {0xA795, 0xA795}, {0xA7AF, 0xA7AF},
+	{0xA7D3, 0xA7D3}, {0xA7D5, 0xA7D5}, {0xA7F8, 0xA7FA}, {0xAB30, 0xAB52},
+	{0xAB54, 0xAB5A}, {0xAB5C, 0xAB68}, {0xFB00, 0xFB06}, {0xFB13, 0xFB17},
+	{0x10780, 0x10780}, {0x10783, 0x10785}, {0x10787, 0x107B0}, {0x107B2, 0x107BA},
+	{0x1D41A, 0x1D433}, {0x1D44E, 0x1D454}, {0x1D456, 0x1D467}, {0x1D482, 0x1D49B},
+	{0x1D4B6, 0x1D4B9}, {0x1D4BB, 0x1D4BB}, {0x1D4BD, 0x1D4C3}, {0x1D4C5, 0x1D4CF},
+	{0x1D4EA, 0x1D503}, {0x1D51E, 0x1D537}, {0x1D552, 0x1D56B}, {0x1D586, 0x1D59F},
+	{0x1D5BA, 0x1D5D3}, {0x1D5EE, 0x1D607}, {0x1D622, 0x1D63B}, {0x1D656, 0x1D66F},
+	{0x1D68A, 0x1D6A5}, {0x1D6C2, 0x1D6DA}, {0x1D6DC, 0x1D6E1}, {0x1D6FC, 0x1D714},
+	{0x1D716, 0x1D71B}, {0x1D736, 0x1D74E}, {0x1D750, 0x1D755}, {0x1D770, 0x1D788},
+	{0x1D78A, 0x1D78F}, {0x1D7AA, 0x1D7C2}, {0x1D7C4, 0x1D7C9}, {0x1D7CB, 0x1D7CB},
+	{0x1DF00, 0x1DF09}, {0x1DF0B, 0x1DF1E},
+};
+
+template<size_t N>
+inline char32_t map(const Mapping (&table)[N], char32_t c) {
+	const auto it = std::lower_bound(table, table + N, c,
+	  [](const Mapping& m, char32_t c) { return m.last < c; });
+	if (it == table + N || c < it->first || (c - it->first) % it->stride != 0) {
+		return c;
+	}
+	return (char32_t)((int32_t)c + it->delta);
+}
+
+template<size_t N>
+inline bool in(const Range (&table)[N], char32_t c) {
+	const auto it = std::lower_bound(table, table + N, c,
+	  [](const Range& r, char32_t c) { return r.last < c; });
+	return it != table + N && it->first <= c;
+}
+
+}
+
+inline char32_t toUpper(char32_t c) {
+	if (c < 0x80) {
+		return (c >= 'a' && c <= 'z') ? c - ('a' - 'A') : c;
+	}
+	return casing::map(casing::TO_UPPER, c);
+}
+
+inline char32_t toLower(char32_t c) {
+	if (c < 0x80) {
+		return (c >= 'A' && c <= 'Z') ? c + ('a' - 'A') : c;
+	}
+	return casing::map(casing::TO_LOWER, c);
+}
+
+inline bool isUpper(char32_t c) {
+	if (c < 0x80) {
+		return c >= 'A' && c <= 'Z';
+	}
+	return toLower(c) != c || casing::in(casing::UPPER_UNMAPPED, c);
+}
+
+inline bool isLower(char32_t c) {
+	if (c < 0x80) {
+		return c >= 'a' && c <= 'z';
+	}
+	return toUpper(c) != c || casing::in(casing::LOWER_UNMAPPED, c);
+}
+
+namespace casing {
+
+// Decode the code point at s[i], moving i past it; a byte that isn't
+// part of valid UTF-8 is returned as a lone surrogate, which is
+// neither upper nor lower case
+inline char32_t next(const std::string& s, size_t& i) {
+	const auto b = (unsigned char)s[i++];
+	size_t len = b < 0xC2 ? 0 : b < 0xE0 ? 1 : b < 0xF0 ? 2 : b < 0xF5 ? 3 : 0;
+	if (len == 0 || i + len > s.size()) {
+		return b < 0x80 ? b : 0xDC00 + b;
+	}
+	char32_t c = b & (0x3F >> len);
+	for (size_t k = 0; k < len; ++k) {
+		const auto cb = (unsigned char)s[i + k];
+		if ((cb & 0xC0) != 0x80) {
+			return 0xDC00 + b;
+		}
+		c = (c << 6) | (cb & 0x3F);
+	}
+	i += len;
+	return c;
+}
+
+inline char32_t next(const std::u16string& s, size_t& i) {
+	const char32_t c = s[i++];
+	if (c >= 0xD800 && c < 0xDC00 && i < s.size() && s[i] >= 0xDC00 &&
+	    s[i] < 0xE000) {
+		return 0x10000 + ((c - 0xD800) << 10) + (s[i++] - 0xDC00);
+	}
+	return c;
+}
+
+inline void append(std::string& out, char32_t c) {
+	if (c < 0x80) {
+		out += (char)c;
+	}
+	else if (c < 0x800) {
+		out += (char)(0xC0 | (c >> 6));
+		out += (char)(0x80 | (c & 0x3F));
+	}
+	else if (c < 0x10000) {
+		out += (char)(0xE0 | (c >> 12));
+		out += (char)(0x80 | ((c >> 6) & 0x3F));
+		out += (char)(0x80 | (c & 0x3F));
+	}
+	else {
+		out += (char)(0xF0 | (c >> 18));
+		out += (char)(0x80 | ((c >> 12) & 0x3F));
+		out += (char)(0x80 | ((c >> 6) & 0x3F));
+		out += (char)(0x80 | (c & 0x3F));
+	}
+}
+
+inline void append(std::u16string& out, char32_t c) {
+	if (c < 0x10000) {
+		out += (char16_t)c;
+	}
+	else {
+		out += (char16_t)(0xD800 + ((c - 0x10000) >> 10));
+		out += (char16_t)(0xDC00 + ((c - 0x10000) & 0x3FF));
+	}
+}
+
+// Apply f to the first n code points of s. Code units that don't
+// change are copied as they are, so invalid UTF-8 passes through.
+template<typename S, typename F>
+inline S mapFirst(const S& s, size_t n, F f) {
+	S out;
+	out.reserve(s.size());
+	size_t i = 0;
+	for (; i < s.size() && n > 0; --n) {
+		const size_t beg = i;
+		const char32_t c = next(s, i);
+		const char32_t m = f(c);
+		if (m == c) {
+			out.append(s, beg, i - beg);
+		}
+		else {
+			append(out, m);
+		}
+	}
+	out.append(s, i, S::npos);
+	return out;
+}
+
+}
+
+enum Casing { lower, Title, UPPER, mIxed };
+
+template<typename S>
+inline Casing getCasing(const S& input) {
+	if (input.empty()) {
+		return mIxed;
+	}
+	bool seenupper = false;
+	bool seenlower = false;
+	bool fstupper = false;
+	bool nonfstupper = false;
+	for (size_t i = 0; i < input.size();) {
+		const char32_t c = casing::next(input, i);
+		if (isUpper(c)) {
+			if (seenlower || seenupper) {
+				nonfstupper = true;
+			}
+			else {
+				fstupper = true;
+			}
+			seenupper = true;
+		}
+		if (isLower(c)) {
+			seenlower = true;
+		}
+	}
+	if (!seenupper) {
+		return lower;
+	}
+	if (!seenlower) {
+		return UPPER;
+	}
+	if (fstupper && !nonfstupper) {
+		return Title;
+	}
+	else {
+		return mIxed;
+	}
+}
+
+template<typename S>
+inline S toupper(const S& input) {
+	return casing::mapFirst(input, S::npos, toUpper);
+}
+
+// Upper-cases the first letter, leaving the rest as it is
+template<typename S>
+inline S totitle(const S& input) {
+	return casing::mapFirst(input, 1, toUpper);
+}
+
+// Lower-cases the first letter only, like totitle
+template<typename S>
+inline S tolower(const S& input) {
+	return casing::mapFirst(input, 1, toLower);
+}
+
+template<typename S>
+inline S withCasing(bool fixedcase, const Casing& inputCasing, const S& input) {
+	if (fixedcase) {
+		return input;
+	}
+	switch (inputCasing) {
+	case Title:
+		return totitle(input);
+	case UPPER:
+		return toupper(input);
+	case mIxed:
+		return input;
+	case lower:
+		return tolower(input);
+	}
+	// should never get to this point
+	return input;
+}
+
+}
+
+#endif
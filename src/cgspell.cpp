@@ -137,6 +137,19 @@ const void print_readings(const vector<string>& ana, const string& form,
 	}
 }
 
+Speller* Speller::clone() const {
+	if (!err || !lex) {
+		throw std::runtime_error(
+		  "libdivvun: ERROR: Can't clone a speller read from a zhfst archive");
+	}
+	auto* s = new Speller(err, lex, verbose, max_analysis_weight, max_weight,
+	  real_word, limit, beam, time_cutoff, max_sent_unknown_rate);
+	s->min_sent_max_unknown = min_sent_max_unknown;
+	s->sent_delimiters = sent_delimiters;
+	s->analyse_when_correct = analyse_when_correct;
+	return s;
+}
+
 void Speller::spell(const string& inform, std::ostream& os) {
 	bool do_suggest = real_word || !speller->spell(inform);
 	if (!do_suggest) {
@@ -211,53 +224,66 @@ void proc_sent(const SpellSent& sent, std::ostream& os, Speller& s) {
 	}
 }
 
-void run_cgspell(std::istream& is, std::ostream& os, Speller& s) {
+// The sentence being read, and its last cohort
+struct CGSpellState {
 	SpellSent sent = { {}, 0 };
 	SpellCohort c = { "", {}, {}, false };
-	for (string line; std::getline(is, line);) {
-		std::match_results<const char*> result;
-		std::regex_match(line.c_str(), result, CG_LINE);
-		if (!result.empty() && result[2].length() != 0) {
-			sent.cohorts.push_back(c);
-			// Was the previous cohort a sent delimiter?
-			std::match_results<const char*> del_res;
-			std::regex_match(c.wf.c_str(), del_res, s.sent_delimiters);
-			if (!del_res.empty() && del_res[0].length() != 0) {
-				proc_sent(sent, os, s);
-				sent = { {}, 0 };
-			}
-			c = SpellCohort({ result[2], {}, {}, false });
-			c.lines.push_back(line);
-		}
-		else if (!result.empty() && result[5].length() != 0) {
-			std::stringstream ana(result[5]);
-			std::string tag;
-			c.unknown = false;
-			while (ana >> tag) {
-				if (tag == tag_unknown) {
-					c.unknown = true;
-				}
-			}
-			if (c.unknown) {
-				sent.n_unknowns += 1;
-			}
-			c.lines.push_back(line);
-		}
-		else if (!result.empty() && result[7].length() != 0) {
-			// TODO: Can we ever get a flush in the middle of readings?
-			sent.cohorts.push_back(c);
+};
+
+void cgspell_line(const string& line, CGSpellState& st, std::ostream& os, Speller& s) {
+	SpellSent& sent = st.sent;
+	SpellCohort& c = st.c;
+	const CGLine cg = lexCGLine(line.c_str());
+	if (!cg.surf.empty()) {
+		sent.cohorts.push_back(c);
+		// Was the previous cohort a sent delimiter?
+		std::match_results<const char*> del_res;
+		std::regex_match(c.wf.c_str(), del_res, s.sent_delimiters);
+		if (!del_res.empty() && del_res[0].length() != 0) {
 			proc_sent(sent, os, s);
 			sent = { {}, 0 };
-			c = SpellCohort({ "", {}, {}, false });
-			std::cout << line << std::endl;
-			os.flush();
 		}
-		else {
-			c.postblank.push_back(line);
+		c = SpellCohort({ string(cg.surf), {}, {}, false });
+		c.lines.push_back(line);
+	}
+	else if (!cg.readings.empty()) {
+		std::stringstream ana{ string(cg.readings) };
+		std::string tag;
+		c.unknown = false;
+		while (ana >> tag) {
+			if (tag == tag_unknown) {
+				c.unknown = true;
+			}
 		}
+		if (c.unknown) {
+			sent.n_unknowns += 1;
+		}
+		c.lines.push_back(line);
+	}
+	else if (cg.type == CGLine::Flush) {
+		// TODO: Can we ever get a flush in the middle of readings?
+		sent.cohorts.push_back(c);
+		proc_sent(sent, os, s);
+		sent = { {}, 0 };
+		c = SpellCohort({ "", {}, {}, false });
+		os << line << std::endl;
+	}
+	else {
+		c.postblank.push_back(line);
+	}
+}
+
+void cgspell_finish(CGSpellState& st, std::ostream& os, Speller& s) {
+	st.sent.cohorts.push_back(st.c);
+	proc_sent(st.sent, os, s);
+}
+
+void run_cgspell(std::istream& is, std::ostream& os, Speller& s) {
+	CGSpellState st;
+	for (string line; std::getline(is, line);) {
+		cgspell_line(line, st, os, s);
 	}
-	sent.cohorts.push_back(c);
-	proc_sent(sent, os, s);
+	cgspell_finish(st, os, s);
 }
 
 }
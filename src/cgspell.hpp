@@ -25,6 +25,7 @@
 #	include <regex>
 #	include <unordered_map>
 #	include <exception>
+#	include <memory>
 
 // divvun-gramcheck:
 #	include "util.hpp"
@@ -56,7 +57,7 @@ class Speller {
 public:
 	Speller(const string& zhfstpath, bool verbose_,
 	  Weight max_analysis_weight_, Weight max_weight_, bool real_word_,
-	  unsigned long limit_, hfst_ospell::Weight beam, float time_cutoff,
+	  unsigned long limit_, hfst_ospell::Weight beam_, float time_cutoff_,
 	  float max_sent_unknown_rate_)
 	  : max_analysis_weight(max_analysis_weight_)
 	  , max_weight(max_weight_)
@@ -64,6 +65,8 @@ public:
 	  , limit(limit_)
 	  , max_sent_unknown_rate(max_sent_unknown_rate_)
 	  , speller(new hfst_ospell::ZHfstOspeller())
+	  , beam(beam_)
+	  , time_cutoff(time_cutoff_)
 	  , verbose(verbose_) {
 		speller->read_zhfst(zhfstpath);
 		if (!speller) {
@@ -71,15 +74,15 @@ public:
 			  "libdivvun: ERROR: Couldn't read zhfst archive " + zhfstpath);
 		}
 		else {
-			speller->set_beam(beam);
-			speller->set_time_cutoff(time_cutoff);
+			speller->set_beam(beam_);
+			speller->set_time_cutoff(time_cutoff_);
 			// s.set_queue_limit(limit); // TODO: This seems to choose first three, not top three (same with /usr/bin/hfst-ospell)
 			// s.set_weight_limit(max_weight); // TODO: Has no effect? (same with /usr/bin/hfst-ospell)
 		}
 	}
 	Speller(const string& errpath, const string& lexpath, bool verbose_,
 	  Weight max_analysis_weight_, Weight max_weight_, bool real_word_,
-	  unsigned long limit_, hfst_ospell::Weight beam, float time_cutoff,
+	  unsigned long limit_, hfst_ospell::Weight beam_, float time_cutoff_,
 	  float max_sent_unknown_rate_)
 	  : max_analysis_weight(max_analysis_weight_)
 	  , max_weight(max_weight_)
@@ -87,6 +90,8 @@ public:
 	  , limit(limit_)
 	  , max_sent_unknown_rate(max_sent_unknown_rate_)
 	  , speller(new hfst_ospell::ZHfstOspeller())
+	  , beam(beam_)
+	  , time_cutoff(time_cutoff_)
 	  , verbose(verbose_) {
 		FILE* err_fp = fopen(errpath.c_str(), "r");
 		if (err_fp == nullptr) {
@@ -98,10 +103,8 @@ public:
 			throw std::runtime_error(
 			  "libdivvun: ERROR: Couldn't read language model " + lexpath);
 		}
-		err = std::unique_ptr<hfst_ospell::Transducer>(
-		  new hfst_ospell::Transducer(err_fp));
-		lex = std::unique_ptr<hfst_ospell::Transducer>(
-		  new hfst_ospell::Transducer(lex_fp));
+		err = std::make_shared<hfst_ospell::Transducer>(err_fp);
+		lex = std::make_shared<hfst_ospell::Transducer>(lex_fp);
 		// This one is freed by ZHfstOspeller, but it seems like its acceptor and errmodel are not!
 		auto lmspeller = new hfst_ospell::Speller(&*err, &*lex);
 		speller->inject_speller(lmspeller);
@@ -111,16 +114,25 @@ public:
 			  " / errmodel " + errpath);
 		}
 		else {
-			speller->set_beam(beam);
-			speller->set_time_cutoff(time_cutoff);
+			speller->set_beam(beam_);
+			speller->set_time_cutoff(time_cutoff_);
 			// s.set_queue_limit(limit); // TODO: This seems to choose first three, not top three (same with /usr/bin/hfst-ospell)
 			// s.set_weight_limit(max_weight); // TODO: Has no effect? (same with /usr/bin/hfst-ospell)
 		}
 	}
 	Speller(hfst_ospell::Transducer* err_, hfst_ospell::Transducer* lex_,
 	  bool verbose_, Weight max_analysis_weight_, Weight max_weight_,
-	  bool real_word_, unsigned long limit_, hfst_ospell::Weight beam,
-	  float time_cutoff, float max_sent_unknown_rate_)
+	  bool real_word_, unsigned long limit_, hfst_ospell::Weight beam_,
+	  float time_cutoff_, float max_sent_unknown_rate_)
+	  : Speller(std::shared_ptr<hfst_ospell::Transducer>(err_),
+	      std::shared_ptr<hfst_ospell::Transducer>(lex_), verbose_,
+	      max_analysis_weight_, max_weight_, real_word_, limit_, beam_,
+	      time_cutoff_, max_sent_unknown_rate_) {}
+	Speller(std::shared_ptr<hfst_ospell::Transducer> err_,
+	  std::shared_ptr<hfst_ospell::Transducer> lex_, bool verbose_,
+	  Weight max_analysis_weight_, Weight max_weight_, bool real_word_,
+	  unsigned long limit_, hfst_ospell::Weight beam_, float time_cutoff_,
+	  float max_sent_unknown_rate_)
 	  : max_analysis_weight(max_analysis_weight_)
 	  , max_weight(max_weight_)
 	  , real_word(real_word_)
@@ -129,6 +141,8 @@ public:
 	  , speller(new hfst_ospell::ZHfstOspeller())
 	  , err(err_)
 	  , lex(lex_)
+	  , beam(beam_)
+	  , time_cutoff(time_cutoff_)
 	  , verbose(verbose_) {
 		// This one is freed by ZHfstOspeller, but it seems like its acceptor and errmodel are not!
 		auto lmspeller = new hfst_ospell::Speller(&*err, &*lex);
@@ -138,8 +152,8 @@ public:
 			  "libdivvun: ERROR: Couldn't read lexicon / errmodel");
 		}
 		else {
-			speller->set_beam(beam);
-			speller->set_time_cutoff(time_cutoff);
+			speller->set_beam(beam_);
+			speller->set_time_cutoff(time_cutoff_);
 			// s.set_queue_limit(limit); // TODO: This seems to choose first three, not top three (same with /usr/bin/hfst-ospell)
 			// s.set_weight_limit(max_weight); // TODO: Has no effect? (same with /usr/bin/hfst-ospell)
 		}
@@ -157,6 +171,10 @@ public:
 	void spell(const string& form, std::ostream& os);
 	bool analyse_when_correct =
 	  false; // Look up the analysis for forms that had an analysis in lex already.
+	// A new Speller sharing the transducers of this one, but with its own
+	// search state and cache, so the two can be used from different threads.
+	// Only possible when created from errmodel and lexicon.
+	Speller* clone() const;
 private:
 	// const void print_readings(const vector<string>& ana,
 	// 			  const string& form,
@@ -167,9 +185,11 @@ private:
 	std::unique_ptr<hfst_ospell::ZHfstOspeller> speller;
 	const string CGSPELL_TAG = "<spelled>";
 	const string CGSPELL_CORRECT_TAG = "<spell_was_correct>";
-	// Only used when initialised with errpath/lexpath:
-	std::unique_ptr<hfst_ospell::Transducer> err;
-	std::unique_ptr<hfst_ospell::Transducer> lex;
+	// Only used when not initialised with a zhfst archive:
+	std::shared_ptr<hfst_ospell::Transducer> err;
+	std::shared_ptr<hfst_ospell::Transducer> lex;
+	const hfst_ospell::Weight beam;
+	const float time_cutoff;
 	// A cache of misspelt words, with suggestions. For server use, where texts are
 	// requested over and over again with very little change, this makes the UI a lot
 	// snappier.
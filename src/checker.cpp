@@ -82,8 +82,15 @@ Checker::Checker(const std::unique_ptr<ArPipeSpec>& spec,
   const string& pipename, bool verbose)
   : pImpl(new Pipeline(spec, from_bytes(pipename), verbose)) {};
 
+Checker::Checker(std::unique_ptr<Pipeline> pipeline)
+  : pImpl(std::move(pipeline)) {};
+
 Checker::~Checker() {};
 
+std::unique_ptr<Checker> Checker::clone() const {
+	return std::unique_ptr<Checker>(new Checker(pImpl->clone()));
+};
+
 void Checker::proc(stringstream& input, stringstream& output) {
 	pImpl->proc(input, output);
 };
@@ -92,6 +99,18 @@ vector<Err> Checker::proc_errs(stringstream& input) {
 	return pImpl->proc_errs(input);
 };
 
+vector<vector<Err>> Checker::proc_errs_batch(const vector<string>& texts) {
+	return pImpl->proc_errs_batch(texts);
+};
+
+void Checker::setThreads(size_t threads) {
+	return pImpl->setThreads(threads);
+};
+
+void Checker::setChunkSize(size_t units) {
+	return pImpl->setChunkSize(units);
+};
+
 const LocalisedPrefs& Checker::prefs() const {
 	return pImpl->prefs;
 };
@@ -100,6 +119,136 @@ void Checker::setIgnores(const std::set<ErrId>& ignores) {
 	return pImpl->setIgnores(ignores);
 };
 
+void Checker::setIncludes(const std::set<ErrId>& includes) {
+	return pImpl->setIncludes(includes);
+};
+
+void Checker::setPipelined(bool pipelined) {
+	return pImpl->setPipelined(pipelined);
+};
+
+void Checker::setProfile(bool profile) {
+	return pImpl->setProfile(profile);
+};
+
+vector<StageStats> Checker::stats() const {
+	return pImpl->stats();
+};
+
+void Checker::resetStats() {
+	return pImpl->resetStats();
+};
+
+void Checker::setTraceOut(const std::string& path) {
+	return pImpl->setTraceOut(path);
+};
+
+void Checker::setCacheSize(size_t max_bytes) {
+	return pImpl->setCacheSize(max_bytes);
+};
+
+CacheStats Checker::cacheStats() const {
+	return pImpl->cacheStats();
+};
+
+CacheStats Checker::generationCacheStats() const {
+	return pImpl->generationCacheStats();
+};
+
+
+// CheckerDocument
+CheckerDocument::CheckerDocument(Checker& checker_, const std::u16string& text)
+  : checker(checker_)
+  , txt(text)
+  , sentences(check(0, txt.size(), {})) {}
+
+CheckerDocument::CheckerDocument(Checker& checker_, const string& text)
+  : CheckerDocument(checker_, fromUtf8(text)) {}
+
+vector<CheckerDocument::Sentence> CheckerDocument::check(size_t beg,
+  size_t end, const std::map<std::u16string, vector<Err>>& old) {
+	vector<Sentence> checked;
+	for (const auto len : splitSentences(txt.substr(beg, end - beg))) {
+		const auto sentence = txt.substr(beg, len);
+		const auto found = old.find(sentence);
+		if (found != old.end()) {
+			checked.push_back({ len, found->second });
+		}
+		else {
+			stringstream input(toUtf8(sentence));
+			checked.push_back({ len, checker.proc_errs(input) });
+		}
+		beg += len;
+	}
+	return checked;
+}
+
+void CheckerDocument::edit(size_t offset, size_t del, const std::u16string& ins) {
+	if (offset > txt.size() || del > txt.size() - offset) {
+		throw std::runtime_error("libdivvun: ERROR: Edit of " +
+		                         std::to_string(del) + " units at " +
+		                         std::to_string(offset) +
+		                         " is outside the text, which is " +
+		                         std::to_string(txt.size()) + " units long");
+	}
+	// Find the sentences from first to last (inclusive) touching the
+	// edit, and their start; since an edit may move the boundaries of
+	// its sentences, we include one more on each side.
+	size_t first = 0;
+	size_t first_beg = 0;
+	while (first + 1 < sentences.size() &&
+	       first_beg + sentences[first].len <= offset) {
+		first_beg += sentences[first].len;
+		++first;
+	}
+	size_t last = first;
+	size_t last_end = first_beg + (sentences.empty() ? 0 : sentences[first].len);
+	while (last + 1 < sentences.size() && last_end <= offset + del) {
+		++last;
+		last_end += sentences[last].len;
+	}
+	if (first > 0) {
+		--first;
+		first_beg -= sentences[first].len;
+	}
+	if (last + 1 < sentences.size()) {
+		++last;
+		last_end += sentences[last].len;
+	}
+	std::map<std::u16string, vector<Err>> old;
+	size_t beg = first_beg;
+	for (size_t i = first; i <= last && i < sentences.size(); ++i) {
+		old[txt.substr(beg, sentences[i].len)] = sentences[i].errs;
+		beg += sentences[i].len;
+	}
+	txt.replace(offset, del, ins);
+	auto checked = check(first_beg, last_end - del + ins.size(), old);
+	const auto from = sentences.begin() + first;
+	const auto to = sentences.empty() ? from : sentences.begin() + last + 1;
+	sentences.insert(sentences.erase(from, to), checked.begin(), checked.end());
+}
+
+void CheckerDocument::edit(size_t offset, size_t del, const string& ins) {
+	edit(offset, del, fromUtf8(ins));
+}
+
+const std::u16string& CheckerDocument::text() const {
+	return txt;
+}
+
+vector<Err> CheckerDocument::errs() const {
+	vector<Err> all;
+	size_t beg = 0;
+	for (const auto& sentence : sentences) {
+		for (auto e : sentence.errs) {
+			e.beg += beg;
+			e.end += beg;
+			all.push_back(e);
+		}
+		beg += sentence.len;
+	}
+	return all;
+}
 
 /**
  * Note: This will silently return an empty vector if the directory doesn't exist.
@@ -85,12 +85,98 @@ class Checker {
 		// we use SuggestCmd.run_errs as the last step.
 		std::vector<Err> proc_errs(std::stringstream& input);
 
+		// Run proc_errs on each of texts, spread over several threads
+		// that keep their pipeline state between calls; results are
+		// in the same order as texts.
+		std::vector<std::vector<Err>> proc_errs_batch(const std::vector<std::string>& texts);
+
+		// Max number of threads for proc_errs_batch; 0 (the default)
+		// means one per CPU. Each thread runs a clone (see clone).
+		void setThreads(size_t threads);
+
+		// Let proc_errs split texts longer than units (UTF-16 code
+		// units) into chunks of whole sentences, checked in parallel
+		// on the threads of proc_errs_batch; error offsets are still
+		// into the whole text. 0 (the default) turns it off.
+		void setChunkSize(size_t units);
+
 		const LocalisedPrefs& prefs() const;
 		void setIgnores(const std::set<ErrId>& ignores);
+		void setIncludes(const std::set<ErrId>& includes);
+
+		// Let proc run the pipeline commands concurrently on the
+		// \0-separated parts of its input; output is unchanged.
+		void setPipelined(bool pipelined);
+
+		// Time and count every run of every pipeline command; off by
+		// default. stats() gives the counters per command, summed
+		// since profiling was turned on or last reset.
+		void setProfile(bool profile);
+		std::vector<StageStats> stats() const;
+		void resetStats();
+
+		// Write spans of every request and command run to path as
+		// Chrome trace events (for chrome://tracing or Perfetto);
+		// empty path turns it off. Defaults to $DIVVUN_TRACE_OUT.
+		void setTraceOut(const std::string& path);
+
+		// Remember proc_errs results for up to about max_bytes of
+		// text and errors, and return them again for the same text
+		// and ignores/includes; 0 (the default) turns it off.
+		// The cache is shared with clones of this Checker.
+		void setCacheSize(size_t max_bytes);
+		CacheStats cacheStats() const;
+		// Lookups in the suggestion generator cache, whose size is
+		// set in the pipespec (<suggest cache-size="bytes">)
+		CacheStats generationCacheStats() const;
+
+		// A new Checker sharing the loaded language data (transducers,
+		// grammars, messages) with this one, but with its own
+		// execution state and settings. A Checker must only be used
+		// by one thread at a time, so give each thread its own clone.
+		// Grammars are shared as they are, but HFST models (tokeniser,
+		// analysers, generator) keep lookup state, so while clones use
+		// them at the same time, each gets a copy: expect up to one
+		// copy of every HFST model per Checker (or clone, or
+		// proc_errs_batch thread) in use at once.
+		std::unique_ptr<Checker> clone() const;
 	private:
+		explicit Checker(std::unique_ptr<Pipeline> pipeline);
 		const std::unique_ptr<Pipeline> pImpl;
 };
 
+/**
+ * A text checked with a Checker, which may then be edited. Each edit
+ * only re-checks the sentences it touches (see splitSentences), and
+ * moves the errors of the others along. Offsets are in UTF-16 units,
+ * as in Err. The Checker must outlive the document.
+ */
+class CheckerDocument {
+	public:
+		CheckerDocument(Checker& checker, const std::u16string& text);
+		CheckerDocument(Checker& checker, const std::string& text);
+
+		// Replace del units at offset with ins
+		void edit(size_t offset, size_t del, const std::u16string& ins);
+		void edit(size_t offset, size_t del, const std::string& ins);
+
+		const std::u16string& text() const;
+		// Errors of the whole text, with offsets into it
+		std::vector<Err> errs() const;
+	private:
+		struct Sentence {
+				size_t len;
+				std::vector<Err> errs; // offsets from start of sentence
+		};
+		Checker& checker;
+		std::u16string txt;
+		std::vector<Sentence> sentences;
+		// Check the sentences of txt from beg to end, reusing the
+		// errors of old sentences with the same text
+		std::vector<Sentence> check(size_t beg, size_t end,
+		  const std::map<std::u16string, std::vector<Err>>& old);
+};
+
 std::set<std::string> searchPaths();
 std::map<Lang, std::vector<std::string>> listLangs(const std::string& extraPath = "");
 
@@ -26,6 +26,7 @@
 #include <set>
 #include <unordered_map>
 #include <regex>
+#include <vector>
 
 namespace divvun {
 
@@ -76,6 +77,38 @@ struct Prefs {
 };
 typedef std::unordered_map<Lang, Prefs> LocalisedPrefs;
 
+/**
+ * Profiling counters for one command of a pipeline, summed over all
+ * calls since profiling was turned on (see Checker::setProfile).
+ * Cohorts and readings are counted in the CG stream format, so they
+ * are 0 for plain text and JSON.
+ */
+struct StageStats {
+		std::string name;         // e.g. "cg grammarchecker.bin"
+		size_t calls = 0;
+		double wall_secs = 0;
+		double max_wall_secs = 0; // the slowest single call
+		double cpu_secs = 0;      // of the thread running the command
+		size_t bytes_in = 0;
+		size_t bytes_out = 0;
+		size_t cohorts_in = 0;
+		size_t readings_in = 0;
+		size_t cohorts_out = 0;
+		size_t readings_out = 0;
+};
+
+/**
+ * Counters of a cache, e.g. the one of Checker::setCacheSize; size and
+ * max_size are in approximate bytes.
+ */
+struct CacheStats {
+		size_t hits = 0;
+		size_t misses = 0;
+		size_t entries = 0;
+		size_t size = 0;
+		size_t max_size = 0;
+};
+
 } // namespace divvun
 
 #endif
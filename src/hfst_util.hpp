@@ -19,14 +19,93 @@
 #ifndef c9249b1422edf6fe_HFST_UTIL_H
 #	define c9249b1422edf6fe_HFST_UTIL_H
 
+#	include <memory>
+
 // hfst:
 #	include <hfst/HfstInputStream.h>
 #	include <hfst/HfstTransducer.h>
 
+// divvun-gramcheck:
+#	include "workqueue.hpp"
+
 namespace divvun {
 
 typedef std::unique_ptr<hfst::HfstOneLevelPaths> HfstPaths1L;
 
+/**
+ * A transducer that may be shared by several pipelines running in
+ * different threads. Lookup in hfst keeps its state in the
+ * transducer, so each lookup gets a copy of its own from a pool;
+ * copies are only made when lookups actually overlap.
+ */
+class SharedTransducer {
+public:
+	explicit SharedTransducer(const hfst::HfstTransducer* t_)
+	  : pool(std::unique_ptr<const hfst::HfstTransducer>(t_),
+	      [](const hfst::HfstTransducer& idle) {
+		      return std::unique_ptr<const hfst::HfstTransducer>(
+		        new hfst::HfstTransducer(idle));
+	      }) {}
+	hfst::HfstOneLevelPaths* lookup_fd(const hfst::StringVector& input,
+	  ssize_t limit, double time_cutoff) const {
+		return pool.take()->lookup_fd(input, limit, time_cutoff);
+	}
+	hfst::HfstOneLevelPaths* lookup_fd(
+	  const std::string& input, ssize_t limit, double time_cutoff) const {
+		return pool.take()->lookup_fd(input, limit, time_cutoff);
+	}
+	// Copy it for at most workers lookups at once
+	void setWorkers(size_t workers) const { pool.setMax(workers); }
+
+private:
+	mutable Pool<const hfst::HfstTransducer> pool;
+};
+
+/**
+ * Convert t to weighted optimized-lookup format, unless it already is
+ * in an optimized-lookup format; lookup_fd on other formats goes
+ * through a much slower and bigger generic path. Takes ownership of t
+ * and returns the converted transducer (deleting t), or t itself if
+ * it didn't need or couldn't be converted. A copy is converted, since
+ * hfst doesn't promise to leave t usable if convert fails.
+ */
+inline const hfst::HfstTransducer* toOptimizedLookup(
+  const hfst::HfstTransducer* t) {
+	const auto type = t->get_type();
+	if (type == hfst::HFST_OL_TYPE || type == hfst::HFST_OLW_TYPE) {
+		return t;
+	}
+	try {
+		std::unique_ptr<hfst::HfstTransducer> ol(new hfst::HfstTransducer(*t));
+		ol->convert(hfst::HFST_OLW_TYPE);
+		delete t;
+		return ol.release();
+	}
+	catch (HfstException& e) {
+		std::cerr << "libdivvun: WARNING: Couldn't convert transducer to "
+		             "optimized-lookup format, lookups will be slow: "
+		          << e.what() << std::endl;
+		return t;
+	}
+}
+
+// Takes ownership of t; nullptr if t is nullptr
+inline std::shared_ptr<const SharedTransducer> shareTransducer(
+  const hfst::HfstTransducer* t) {
+	if (t == nullptr) {
+		return nullptr;
+	}
+	return std::make_shared<const SharedTransducer>(toOptimizedLookup(t));
+}
+
+// For the optional transducers (t may be nullptr)
+inline void setWorkers(
+  const std::shared_ptr<const SharedTransducer>& t, size_t workers) {
+	if (t) {
+		t->setWorkers(workers);
+	}
+}
+
 inline const hfst::HfstTransducer* readTransducer(std::istream& is) {
 	hfst::HfstInputStream* in = nullptr;
 	try {
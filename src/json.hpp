@@ -19,82 +19,200 @@
 #ifndef b2070ddb5ed4e0b7_JSON_H
 #define b2070ddb5ed4e0b7_JSON_H
 
-#include <vector>
+#include <cstdint>
+#include <cstring>
 #include <string>
-#include <algorithm>
-#include <sstream>
 #include <iostream>
-#include <iomanip>
-#include <locale>
+#include <stdexcept>
 
-#include "util.hpp"
+#include "transcode.hpp"
 
 namespace json {
 
+/**
+ * The functions named append_* write straight onto the end of out,
+ * for building a whole document in one buffer; the others return a
+ * new string.
+ */
+
+// Append \uXXXX, for code units up to 0xFFFF
+inline void append_uhex(std::string& out, const unsigned i)
+{
+	static const char digits[] = "0123456789ABCDEF";
+	const char hex[] = { '\\', 'u', digits[(i >> 12) & 0xF], digits[(i >> 8) & 0xF],
+	                     digits[(i >> 4) & 0xF], digits[i & 0xF] };
+	out.append(hex, sizeof(hex));
+}
+
 inline const std::string uhex(const int i)
 {
-	std::stringstream ss;
-	ss << "\\u";
-	ss << std::hex << std::setfill('0') << std::uppercase;
-	ss << std::setw(4) << static_cast<unsigned>(i);
-	return ss.str();
+	std::string s;
+	append_uhex(s, static_cast<unsigned>(i));
+	return s;
 }
 
-inline const std::string esc(const std::u16string& str) {
-	std::vector<char16_t> os;
-	for (const char16_t& c : str) {
-		switch(c) {
-			case '"':
-				os.push_back('\\');
-				os.push_back('"');
-				break;
-			case '\\':
-				os.push_back('\\');
-				os.push_back('\\');
+// Append the escape for c if it needs one, returning false if not
+inline bool append_escaped(std::string& out, const char32_t c)
+{
+	switch(c) {
+		case '"':
+			out += "\\\"";
+			return true;
+		case '\\':
+			out += "\\\\";
+			return true;
+		case '\n': // Could use uhex, but looks nicer:
+			out += "\\n";
+			return true;
+		default:
+			if(c <= 0x1f || (c >= 0x7f && c <= 0x9f)) {
+				append_uhex(out, c);
+				return true;
+			}
+			return false;
+	}
+}
+
+inline void append_esc(std::string& out, const std::u16string& str)
+{
+	const char16_t* in = str.data();
+	const size_t n = str.size();
+	size_t i = 0;
+	while (i < n) {
+		// Copy the run up to the next char that needs escaping as it is:
+		size_t k = i;
+		while (k < n && in[k] >= 0x20 && in[k] != '"' && in[k] != '\\'
+		       && (in[k] < 0x7f || in[k] > 0x9f)) {
+			++k;
+		}
+		divvun::transcode::appendUtf8(in + i, k - i, out);
+		if (k < n) {
+			append_escaped(out, in[k++]);
+		}
+		i = k;
+	}
+}
+
+/**
+ * Whether any byte of the 8 in w is an ASCII control char, '"', '\\'
+ * or 0x7F and up (all of which need escaping, or may start a C1
+ * control char). May say yes for a byte following one of those, but
+ * never says no wrongly.
+ */
+inline bool any_special(const uint64_t w)
+{
+	const uint64_t ones = 0x0101010101010101ULL;
+	const uint64_t highs = 0x8080808080808080ULL;
+	const uint64_t quote = w ^ (ones * '"');
+	const uint64_t bslash = w ^ (ones * '\\');
+	return (((w - ones * 0x20)
+	         | (quote - ones)
+	         | (bslash - ones)
+	         | w
+	         | (w + ones))
+	        & highs) != 0;
+}
+
+// Escape UTF-8 text, throwing a utf8::exception if it isn't valid
+inline void append_esc(std::string& out, const std::string& str)
+{
+	const char* in = str.data();
+	const size_t n = str.size();
+	size_t i = 0;
+	while (i < n) {
+		// Copy the run up to the next byte that needs a closer look as it is:
+		size_t k = i;
+		for (uint64_t w; k + 8 <= n; k += 8) {
+			std::memcpy(&w, in + k, 8);
+			if (any_special(w)) {
 				break;
-			case '\n': // Could use uhex, but looks nicer:
-				os.push_back('\\');
-				os.push_back('n');
+			}
+		}
+		while (k < n) {
+			const auto b = static_cast<unsigned char>(in[k]);
+			if (b < 0x20 || b == '"' || b == '\\' || b >= 0x7f) {
 				break;
-			default:
-				auto ci = (int)c;
-				if((sizeof(c) == 1 || static_cast<unsigned>(c) < 256)
-				   && (ci<=0x1f ||
-				       ci==0x7f ||
-				       (ci>=0x80 && ci<=0x9f) ||
-				       c == '\\' ||
-				       c == '"')) {
-					for (const auto cc : uhex(ci)) {
-						os.push_back(cc);
-					}
-				}
-				else {
-					os.push_back(c);
-				}
+			}
+			++k;
+		}
+		out.append(in + i, k - i);
+		if (k == n) {
+			break;
+		}
+		const auto b = static_cast<unsigned char>(in[k]);
+		if (b < 0x80) {
+			append_escaped(out, b);
+			i = k + 1;
+			continue;
+		}
+		i = k;
+		const char32_t c = divvun::transcode::decodeUtf8(in, n, i);
+		if (!append_escaped(out, c)) {
+			out.append(in + k, i - k);
 		}
 	}
-	return divvun::toUtf8(std::u16string(os.begin(), os.end()));
 }
 
-inline const std::string str(const std::u16string& s)
+template<typename String>
+inline void append_str(std::string& out, const String& s)
 {
-	return "\""+esc(s)+"\"";
+	out += '"';
+	append_esc(out, s);
+	out += '"';
 }
 
-inline const std::string key(const std::u16string& s)
+template<typename String>
+inline void append_key(std::string& out, const String& s)
 {
-	return str(s)+":";
+	append_str(out, s);
+	out += ':';
 }
 
 template<typename Container>
-inline const std::string str_arr(const Container& ss)
+inline void append_str_arr(std::string& out, const Container& ss)
 {
-	std::ostringstream os;
+	out += '[';
+	bool wantsep = false;
 	for(const auto& s : ss) {
-		os << str(s) << ",";
+		if (wantsep) {
+			out += ',';
+		}
+		append_str(out, s);
+		wantsep = true;
 	}
-	const auto& str = os.str();
-	return "[" + str.substr(0, str.size() - 1) + "]";
+	out += ']';
+}
+
+template<typename String>
+inline const std::string esc(const String& s)
+{
+	std::string out;
+	append_esc(out, s);
+	return out;
+}
+
+template<typename String>
+inline const std::string str(const String& s)
+{
+	std::string out;
+	append_str(out, s);
+	return out;
+}
+
+template<typename String>
+inline const std::string key(const String& s)
+{
+	std::string out;
+	append_key(out, s);
+	return out;
+}
+
+template<typename Container>
+inline const std::string str_arr(const Container& ss)
+{
+	std::string out;
+	append_str_arr(out, ss);
+	return out;
 }
 
 inline void sanity_test() {
@@ -104,6 +222,11 @@ inline void sanity_test() {
 		std::cerr << "Error in json::key\n GOT: "<< got << "\nWANT: " << want << std::endl;
 		throw std::runtime_error("JSON sanity check failed, major regression!");
 	}
+	got = json::key(std::string("e\tr\"r\\s\nfoo"));
+	if(got != want){
+		std::cerr << "Error in json::key of UTF-8\n GOT: "<< got << "\nWANT: " << want << std::endl;
+		throw std::runtime_error("JSON sanity check failed, major regression!");
+	}
 }
 
 }
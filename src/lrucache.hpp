@@ -0,0 +1,144 @@
+/*
+* Copyright (C) 2026, Kevin Brubeck Unhammer <unhammer@fsfe.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// A size-bounded least-recently-used cache
+
+
+#pragma once
+#ifndef b6e1f48d2c0a7359_LRUCACHE_H
+#	define b6e1f48d2c0a7359_LRUCACHE_H
+
+#	include <cstddef>
+#	include <functional>
+#	include <list>
+#	include <mutex>
+#	include <unordered_map>
+#	include <utility>
+
+// divvun-gramcheck:
+#	include "checkertypes.hpp"
+
+namespace divvun {
+
+/**
+ * Maps K to V, dropping the least recently used entries when the
+ * total size of entries goes over max_size. sizeOf gives the size of
+ * one entry, in whatever unit max_size is in (typically approximate
+ * bytes). May be used from several threads at once.
+ */
+template<typename K, typename V, typename Hash = std::hash<K>>
+class LruCache {
+public:
+	using SizeOf = std::function<size_t(const K&, const V&)>;
+
+	LruCache(size_t max_size_, SizeOf sizeOf_)
+	  : max_size(max_size_)
+	  , sizeOf(std::move(sizeOf_)) {}
+	LruCache(LruCache const&) = delete;
+	LruCache& operator=(LruCache const&) = delete;
+
+	// Copy the value for key into value, if there is one
+	bool get(const K& key, V& value) {
+		std::lock_guard<std::mutex> lock(mutex);
+		const auto it = entries.find(key);
+		if (it == entries.end()) {
+			++counts.misses;
+			return false;
+		}
+		++counts.hits;
+		order.splice(order.begin(), order, it->second.pos);
+		value = it->second.value;
+		return true;
+	}
+
+	void put(const K& key, V value) {
+		const size_t size = sizeOf(key, value);
+		std::lock_guard<std::mutex> lock(mutex);
+		if (size > max_size) {
+			return; // would only push everything else out
+		}
+		auto it = entries.find(key);
+		if (it != entries.end()) {
+			counts.size -= it->second.size;
+			it->second.value = std::move(value);
+			it->second.size = size;
+			order.splice(order.begin(), order, it->second.pos);
+		}
+		else {
+			it = entries.emplace(key, Entry { std::move(value), size, {} }).first;
+			order.push_front(&it->first);
+			it->second.pos = order.begin();
+		}
+		counts.size += size;
+		shrink();
+	}
+
+	void clear() {
+		std::lock_guard<std::mutex> lock(mutex);
+		entries.clear();
+		order.clear();
+		counts.size = 0;
+	}
+
+	void setMaxSize(size_t max_size_) {
+		std::lock_guard<std::mutex> lock(mutex);
+		max_size = max_size_;
+		shrink();
+	}
+
+	CacheStats stats() const {
+		std::lock_guard<std::mutex> lock(mutex);
+		CacheStats st = counts;
+		st.entries = entries.size();
+		st.max_size = max_size;
+		return st;
+	}
+
+	void resetStats() {
+		std::lock_guard<std::mutex> lock(mutex);
+		counts.hits = 0;
+		counts.misses = 0;
+	}
+
+private:
+	struct Entry {
+		V value;
+		size_t size;
+		typename std::list<const K*>::iterator pos;
+	};
+	// Keys live in entries; order points to them, most recently used first
+	std::unordered_map<K, Entry, Hash> entries;
+	std::list<const K*> order;
+	size_t max_size;
+	const SizeOf sizeOf;
+	CacheStats counts;
+	mutable std::mutex mutex;
+
+	void shrink() {
+		while (counts.size > max_size && !order.empty()) {
+			const auto it = entries.find(*order.back());
+			counts.size -= it->second.size;
+			order.pop_back();
+			entries.erase(it);
+		}
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,629 @@
+/*
+* Copyright (C) 2026, Kevin Brubeck Unhammer <unhammer@fsfe.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#ifdef HAVE_CONFIG_H
+#	include <config.h>
+#endif
+
+#include "pipeline.hpp"
+#include "json.hpp"
+#include "version.hpp"
+#include "cxxopts.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <sys/resource.h>
+
+using divvun::Pipeline;
+using divvun::StageStats;
+using divvun::fromUtf8;
+using divvun::toUtf8;
+
+std::unique_ptr<Pipeline> loadPipeline(cxxopts::Options& options) {
+	std::u16string pipename;
+	if (options.count("variant")) {
+		pipename = fromUtf8(options["variant"].as<std::string>());
+	}
+	if (options.count("spec")) {
+		const auto& path = options["spec"].as<std::string>();
+		const std::unique_ptr<divvun::PipeSpec> spec(new divvun::PipeSpec(path));
+		if (pipename.empty()) {
+			pipename = spec->default_pipe;
+		}
+		if (spec->pnodes.find(pipename) == spec->pnodes.end()) {
+			throw std::runtime_error("divvun-bench: ERROR: Couldn't find pipe " +
+			                         toUtf8(pipename) + " in " + path);
+		}
+		return std::unique_ptr<Pipeline>(new Pipeline(spec, pipename, false, false));
+	}
+	const auto& path = options["archive"].as<std::string>();
+	const auto& ar_spec = divvun::readArPipeSpec(path);
+	if (pipename.empty()) {
+		pipename = ar_spec->spec->default_pipe;
+	}
+	if (ar_spec->spec->pnodes.find(pipename) == ar_spec->spec->pnodes.end()) {
+		throw std::runtime_error("divvun-bench: ERROR: Couldn't find pipe " +
+		                         toUtf8(pipename) + " in " + path);
+	}
+	return std::unique_ptr<Pipeline>(new Pipeline(ar_spec, pipename, false, false));
+}
+
+// One request per line, or per \0-separated part if sep is '\0'
+std::vector<std::string> readCorpus(const std::string& path, char sep) {
+	std::ifstream is(path, std::ios::binary);
+	if (!is) {
+		throw std::runtime_error("divvun-bench: ERROR: Couldn't open corpus " + path);
+	}
+	std::vector<std::string> requests;
+	for (std::string request; std::getline(is, request, sep);) {
+		if (!request.empty()) {
+			requests.push_back(request);
+		}
+	}
+	return requests;
+}
+
+// Nearest-rank percentile of sorted values
+double percentile(const std::vector<double>& sorted, double p) {
+	if (sorted.empty()) {
+		return 0;
+	}
+	size_t rank = (size_t)std::ceil(p / 100 * sorted.size());
+	return sorted[std::max<size_t>(rank, 1) - 1];
+}
+
+size_t peakRssKb() {
+	struct rusage usage;
+	if (getrusage(RUSAGE_SELF, &usage) != 0) {
+		return 0;
+	}
+#ifdef __APPLE__
+	return usage.ru_maxrss / 1024; // bytes on macOS
+#else
+	return usage.ru_maxrss;
+#endif
+}
+
+// What divvun::lexCGLine replaced; kept to check and time it against
+const std::basic_regex<char> CG_LINE(
+  "^"
+  "(\"<(.*)>\".*"                             // wordform, group 2
+  "|(\t+)(\"[^\"]*\"\\S*)((?:\\s+\\S+)*)\\s*" // reading, group 3, 4, 5
+  "|:(.*)"                                    // blank, group 6
+  "|(<STREAMCMD:FLUSH>)"                      // flush, group 7
+  "|(;\t+.*)"                                 // traced reading, group 8
+  ")");
+
+bool sameAsRegex(const std::string& line) {
+	std::match_results<const char*> result;
+	std::regex_match(line.c_str(), result, CG_LINE);
+	const divvun::CGLine cg = divvun::lexCGLine(line.c_str());
+	return result.empty() == (cg.type == divvun::CGLine::Unmatched) &&
+	       result[0].str() == cg.all && result[2].str() == cg.surf &&
+	       result[3].str() == cg.subs && result[4].str() == cg.lemma &&
+	       result[5].str() == cg.readings && result[6].str() == cg.blank &&
+	       (result[7].length() != 0) == (cg.type == divvun::CGLine::Flush) &&
+	       result[8].str() == cg.trace;
+}
+
+// Time lexCGLine against the CG_LINE regex on the lines of a CG file
+int benchCGLexer(const std::string& path, size_t repeat) {
+	const auto lines = readCorpus(path, '\n');
+	for (const auto& line : lines) {
+		if (!sameAsRegex(line)) {
+			std::cerr << "divvun-bench: ERROR: lexCGLine and regex differ on line: "
+			          << line << std::endl;
+			return EXIT_FAILURE;
+		}
+	}
+	size_t matches = 0;
+	auto beg = std::chrono::steady_clock::now();
+	for (size_t r = 0; r < repeat; ++r) {
+		for (const auto& line : lines) {
+			std::match_results<const char*> result;
+			std::regex_match(line.c_str(), result, CG_LINE);
+			matches += result.empty() ? 0 : 1;
+		}
+	}
+	const double regex_secs = std::chrono::duration<double>(
+	  std::chrono::steady_clock::now() - beg)
+	                            .count();
+	beg = std::chrono::steady_clock::now();
+	for (size_t r = 0; r < repeat; ++r) {
+		for (const auto& line : lines) {
+			const divvun::CGLine cg = divvun::lexCGLine(line.c_str());
+			matches -= cg.type == divvun::CGLine::Unmatched ? 0 : 1;
+		}
+	}
+	const double lexer_secs = std::chrono::duration<double>(
+	  std::chrono::steady_clock::now() - beg)
+	                            .count();
+	std::cout << std::fixed << std::setprecision(6) << "{\"lines\":"
+	          << lines.size() * repeat << ",\"regex_secs\":" << regex_secs
+	          << ",\"lexer_secs\":" << lexer_secs << ",\"speedup\":"
+	          << (lexer_secs > 0 ? regex_secs / lexer_secs : 0)
+	          << ",\"mismatched_counts\":" << matches << "}" << std::endl;
+	return matches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// What the O(N log N) divvun::expand_errs replaced (comparing every
+// pair); kept to check and time it against
+void expandErrsPairwise(
+  std::vector<divvun::Err>& errs, const std::u16string& text) {
+	const auto n = errs.size();
+	if (n < 2) {
+		return;
+	}
+	auto byBeg = [](const divvun::Err& a, const divvun::Err& b) {
+		return a.beg < b.beg;
+	};
+	auto byEnd = [](const divvun::Err& a, const divvun::Err& b) {
+		return a.end < b.end;
+	};
+	std::sort(errs.begin(), errs.end(), byBeg);
+	for (size_t i = 1; i < n; ++i) {
+		divvun::Err& e = errs[i];
+		for (size_t j = 0; j < i; ++j) {
+			const divvun::Err& f = errs[j];
+			if (f.beg < e.beg && f.end >= e.beg) {
+				const size_t len = e.beg - f.beg;
+				const std::u16string& add = text.substr(f.beg, len);
+				e.form = add + e.form;
+				e.beg = e.beg - len;
+				for (std::u16string& r : e.rep) {
+					r = add + r;
+				}
+			}
+		}
+	}
+	std::sort(errs.begin(), errs.end(), byEnd);
+	for (size_t i = n - 1; i > 0; --i) {
+		divvun::Err& e = errs[i - 1];
+		for (size_t j = n; j > i; --j) {
+			const auto& f = errs[j - 1];
+			if (f.end > e.end && f.beg <= e.end) {
+				const size_t len = f.end - e.end;
+				const std::u16string& add = text.substr(e.end, len);
+				e.form = e.form + add;
+				e.end = e.end + len;
+				for (std::u16string& r : e.rep) {
+					r = r + add;
+				}
+			}
+		}
+	}
+}
+
+// Time expand_errs against expandErrsPairwise on n random, heavily
+// overlapping errs (the same ones each run)
+int benchExpandErrs(size_t n, size_t repeat) {
+	std::mt19937 rng(42);
+	std::u16string text;
+	for (size_t i = 0; i < 2 * n + 20; ++i) {
+		text += (char16_t)(u'a' + rng() % 26);
+	}
+	std::vector<divvun::Err> errs(n);
+	for (auto& e : errs) {
+		e.beg = rng() % (2 * n);
+		e.end = e.beg + rng() % 20;
+		e.form = text.substr(e.beg, e.end - e.beg);
+		e.err = u"stress";
+		e.rep = { u"x" };
+	}
+	auto expanded = errs;
+	auto pairwise = errs;
+	divvun::expand_errs(expanded, text);
+	expandErrsPairwise(pairwise, text);
+	size_t mismatches = 0;
+	for (size_t i = 0; i < n; ++i) {
+		const auto& a = expanded[i];
+		const auto& b = pairwise[i];
+		if (a.beg != b.beg || a.end != b.end || a.form != b.form ||
+		    a.rep != b.rep) {
+			++mismatches;
+		}
+	}
+	double pairwise_secs = 0;
+	double expand_secs = 0;
+	for (size_t r = 0; r < repeat; ++r) {
+		pairwise = errs;
+		auto beg = std::chrono::steady_clock::now();
+		expandErrsPairwise(pairwise, text);
+		pairwise_secs += std::chrono::duration<double>(
+		  std::chrono::steady_clock::now() - beg)
+		                   .count();
+		expanded = errs;
+		beg = std::chrono::steady_clock::now();
+		divvun::expand_errs(expanded, text);
+		expand_secs += std::chrono::duration<double>(
+		  std::chrono::steady_clock::now() - beg)
+		                 .count();
+	}
+	std::cout << std::fixed << std::setprecision(6) << "{\"errs\":" << n
+	          << ",\"runs\":" << repeat << ",\"pairwise_secs\":" << pairwise_secs
+	          << ",\"expand_secs\":" << expand_secs << ",\"speedup\":"
+	          << (expand_secs > 0 ? pairwise_secs / expand_secs : 0)
+	          << ",\"mismatched_errs\":" << mismatches << "}" << std::endl;
+	return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Every set of kernels this CPU can run, best last
+std::vector<divvun::transcode::Kernels> allKernels() {
+	std::vector<divvun::transcode::Kernels> all = { { "scalar",
+		divvun::transcode::widenScalar, divvun::transcode::narrowScalar } };
+#ifdef DIVVUN_TRANSCODE_X86
+	all.push_back(
+	  { "sse2", divvun::transcode::widenSse2, divvun::transcode::narrowSse2 });
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		all.push_back({ "avx2", divvun::transcode::widenAvx2,
+		  divvun::transcode::narrowAvx2 });
+	}
+#endif
+	return all;
+}
+
+/**
+ * Lines that end blocks at every offset: ASCII runs of odd and even
+ * lengths around the block sizes, followed by 2-, 3- and 4-byte
+ * sequences.
+ */
+std::vector<std::string> edgeLines() {
+	std::vector<std::string> lines;
+	for (const std::string tail : { "", "\xC3\xA1", "\xE2\x82\xAC",
+	       "\xF0\x9F\x98\x80", "\xF0\x9F\x98\x80" "a\xC3\xA1" }) {
+		for (size_t len = 0; len <= 67; ++len) {
+			std::string line;
+			for (size_t j = 0; j < len; ++j) {
+				line += (char)('a' + j % 26);
+			}
+			lines.push_back(line + tail);
+			lines.push_back(tail + line + tail);
+		}
+	}
+	return lines;
+}
+
+// How many lines some kernels transcode differently from utf8cpp
+size_t transcodeMismatches(const std::vector<std::string>& lines) {
+	const auto kernels = allKernels();
+	size_t mismatches = 0;
+	for (const auto& line : lines) {
+		std::u16string u16;
+		utf8::utf8to16(line.begin(), line.end(), std::back_inserter(u16));
+		std::string u8;
+		utf8::utf16to8(u16.begin(), u16.end(), std::back_inserter(u8));
+		bool same = true;
+		for (const auto& kern : kernels) {
+			std::u16string to16;
+			divvun::transcode::utf8To16(line, to16, kern);
+			std::string to8;
+			divvun::transcode::utf16To8(u16, to8, kern);
+			same = same && to16 == u16 && to8 == u8;
+		}
+		if (!same) {
+			++mismatches;
+		}
+	}
+	return mismatches;
+}
+
+// Time fromUtf8/toUtf8 on the lines of a file against utf8cpp, which
+// they replaced, and against their own scalar kernels
+int benchTranscode(const std::string& path, size_t repeat) {
+	const auto lines = readCorpus(path, '\n');
+	size_t bytes = 0;
+	for (const auto& line : lines) {
+		bytes += line.size();
+	}
+	const size_t mismatches =
+	  transcodeMismatches(lines) + transcodeMismatches(edgeLines());
+	const divvun::transcode::Kernels scalar = allKernels().front();
+	auto time = [&](const std::function<void(const std::string&)>& roundtrip) {
+		const auto beg = std::chrono::steady_clock::now();
+		for (size_t r = 0; r < repeat; ++r) {
+			for (const auto& line : lines) {
+				roundtrip(line);
+			}
+		}
+		const double secs = std::chrono::duration<double>(
+		  std::chrono::steady_clock::now() - beg)
+		                      .count();
+		return bytes * repeat > 0 ? secs * 1e9 / (bytes * repeat) : 0;
+	};
+	size_t sink = 0;
+	const double utf8cpp_ns = time([&](const std::string& line) {
+		std::u16string u16;
+		utf8::utf8to16(line.begin(), line.end(), std::back_inserter(u16));
+		std::string u8;
+		utf8::utf16to8(u16.begin(), u16.end(), std::back_inserter(u8));
+		sink += u8.size();
+	});
+	const double scalar_ns = time([&](const std::string& line) {
+		std::u16string u16;
+		divvun::transcode::utf8To16(line, u16, scalar);
+		std::string u8;
+		divvun::transcode::utf16To8(u16, u8, scalar);
+		sink -= u8.size();
+	});
+	const double ns = time([&](const std::string& line) {
+		sink += toUtf8(fromUtf8(line)).size();
+	});
+	std::cout << std::fixed << std::setprecision(3)
+	          << "{\"bytes\":" << bytes * repeat << ",\"isa\":\""
+	          << divvun::transcode::kernels().isa
+	          << "\",\"utf8cpp_ns_per_byte\":" << utf8cpp_ns
+	          << ",\"scalar_ns_per_byte\":" << scalar_ns
+	          << ",\"ns_per_byte\":" << ns << ",\"speedup\":"
+	          << (ns > 0 ? utf8cpp_ns / ns : 0)
+	          << ",\"mismatched_lines\":" << mismatches
+	          << ",\"roundtripped_bytes\":" << sink << "}" << std::endl;
+	return mismatches == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+void printStageJson(std::ostream& os, const StageStats& st) {
+	os << "{" << json::key(u"name") << json::str(st.name)
+	   << ",\"calls\":" << st.calls << ",\"wall_secs\":" << st.wall_secs
+	   << ",\"max_wall_secs\":" << st.max_wall_secs
+	   << ",\"cpu_secs\":" << st.cpu_secs << ",\"bytes_in\":" << st.bytes_in
+	   << ",\"bytes_out\":" << st.bytes_out
+	   << ",\"cohorts_in\":" << st.cohorts_in
+	   << ",\"readings_in\":" << st.readings_in
+	   << ",\"cohorts_out\":" << st.cohorts_out
+	   << ",\"readings_out\":" << st.readings_out << "}";
+}
+
+int main(int argc, char** argv) {
+	try {
+		cxxopts::Options options(argv[0],
+		  " - benchmark a pipeline, or one stage of it, on a corpus\n"
+		  "Prints a JSON object with throughput, latency percentiles and peak "
+		  "memory use.");
+
+		options.add_options()("s,spec", "Pipeline XML specification",
+		  cxxopts::value<std::string>(), "FILE")("a,archive",
+		  "Zipped pipeline archive of language data",
+		  cxxopts::value<std::string>(), "FILE")("n,variant",
+		  "Name of the pipeline variant", cxxopts::value<std::string>(),
+		  "NAME")("c,corpus", "Corpus to run, one request per line",
+		  cxxopts::value<std::string>(), "FILE")("j,concurrency",
+		  "Run N requests at a time, each in its own thread (default: 1)",
+		  cxxopts::value<size_t>(), "N")("r,repeat",
+		  "Run the corpus N times (default: 1)", cxxopts::value<size_t>(),
+		  "N")("w,warmup",
+		  "Untimed requests per thread before starting (default: 0)",
+		  cxxopts::value<size_t>(), "N")("S,stage",
+		  "Only time command number I of the pipeline (see --list-stages); "
+		  "its input is recorded from running the commands before it on the "
+		  "corpus", cxxopts::value<size_t>(), "I")("cg-input",
+		  "With --stage, the corpus is already input to that stage, with "
+		  "requests separated by \\0")("list-stages",
+		  "Print the numbers and names of the pipeline commands")("profile",
+		  "Also include the time spent per pipeline command")("cg-lexer",
+		  "Instead of a pipeline, time the CG stream line lexer against "
+		  "the regex it replaced on the lines of FILE",
+		  cxxopts::value<std::string>(), "FILE")("expand-errs",
+		  "Instead of a pipeline, time expanding N random overlapping "
+		  "errors against comparing every pair of them",
+		  cxxopts::value<size_t>(), "N")("transcode",
+		  "Instead of a pipeline, time UTF-8/UTF-16 conversion of the "
+		  "lines of FILE against the utf8cpp functions it replaced",
+		  cxxopts::value<std::string>(), "FILE")(
+		  "V,version", "Version information")("h,help", "Print help");
+
+		options.parse(argc, argv);
+
+		if (argc > 1) {
+			std::cout << options.help({ "" }) << std::endl;
+			std::cerr << argv[0] << " ERROR: got " << argc - 1
+			          << " arguments; expected none" << std::endl;
+			return EXIT_FAILURE;
+		}
+		if (options.count("help")) {
+			std::cout << options.help({ "" }) << std::endl;
+			return EXIT_SUCCESS;
+		}
+		if (options.count("version")) {
+			divvun::print_version(argv[0]);
+			return EXIT_SUCCESS;
+		}
+		if (options.count("cg-lexer")) {
+			return benchCGLexer(options["cg-lexer"].as<std::string>(),
+			  options.count("repeat") ? options["repeat"].as<size_t>() : 1);
+		}
+		if (options.count("expand-errs")) {
+			return benchExpandErrs(options["expand-errs"].as<size_t>(),
+			  options.count("repeat") ? options["repeat"].as<size_t>() : 1);
+		}
+		if (options.count("transcode")) {
+			return benchTranscode(options["transcode"].as<std::string>(),
+			  options.count("repeat") ? options["repeat"].as<size_t>() : 1);
+		}
+		if (options.count("spec") + options.count("archive") != 1) {
+			std::cerr << argv[0]
+			          << " ERROR: expecting one of --spec/--archive (see --help)"
+			          << std::endl;
+			return EXIT_FAILURE;
+		}
+
+		const auto pipeline = loadPipeline(options);
+		const size_t n_stages = pipeline->stats().size();
+		if (n_stages == 0) {
+			std::cerr << argv[0] << " ERROR: the pipeline has no commands"
+			          << std::endl;
+			return EXIT_FAILURE;
+		}
+		if (options.count("list-stages")) {
+			const auto& stats = pipeline->stats();
+			for (size_t i = 0; i < stats.size(); ++i) {
+				std::cout << i << "\t" << stats[i].name << std::endl;
+			}
+			return EXIT_SUCCESS;
+		}
+		if (!options.count("corpus")) {
+			std::cerr << argv[0] << " ERROR: expecting --corpus (see --help)"
+			          << std::endl;
+			return EXIT_FAILURE;
+		}
+		size_t from = 0;
+		size_t to = n_stages;
+		if (options.count("stage")) {
+			from = options["stage"].as<size_t>();
+			to = from + 1;
+			if (to > n_stages) {
+				std::cerr << argv[0] << " ERROR: the pipeline only has "
+				          << n_stages << " commands (see --list-stages)"
+				          << std::endl;
+				return EXIT_FAILURE;
+			}
+		}
+		const bool cg_input = options.count("cg-input");
+		std::vector<std::string> requests =
+		  readCorpus(options["corpus"].as<std::string>(), cg_input ? '\0' : '\n');
+		if (from > 0 && !cg_input) {
+			for (auto& request : requests) {
+				std::stringstream in(request);
+				std::stringstream out;
+				pipeline->proc_stages(0, from, in, out);
+				request = out.str();
+			}
+		}
+		const size_t concurrency =
+		  std::max<size_t>(1, options.count("concurrency")
+		                        ? options["concurrency"].as<size_t>()
+		                        : 1);
+		const size_t repeat =
+		  options.count("repeat") ? options["repeat"].as<size_t>() : 1;
+		const size_t warmup =
+		  options.count("warmup") ? options["warmup"].as<size_t>() : 0;
+		const bool profile = options.count("profile");
+
+		std::vector<std::unique_ptr<Pipeline>> clones;
+		std::vector<Pipeline*> workers { pipeline.get() };
+		while (workers.size() < concurrency) {
+			clones.emplace_back(pipeline->clone());
+			workers.push_back(clones.back().get());
+		}
+		auto runOne = [&](Pipeline& p, const std::string& request) {
+			std::stringstream in(request);
+			std::stringstream out;
+			p.proc_stages(from, to, in, out);
+		};
+		for (Pipeline* p : workers) {
+			for (size_t i = 0; i < warmup && !requests.empty(); ++i) {
+				runOne(*p, requests[i % requests.size()]);
+			}
+			p->setProfile(profile);
+		}
+
+		const size_t total = requests.size() * repeat;
+		std::vector<double> latencies(total);
+		std::atomic<size_t> next(0);
+		std::mutex error_mutex;
+		std::exception_ptr error = nullptr;
+		auto work = [&](Pipeline* p) {
+			try {
+				for (size_t i = next++; i < total; i = next++) {
+					const auto beg = std::chrono::steady_clock::now();
+					runOne(*p, requests[i % requests.size()]);
+					latencies[i] = std::chrono::duration<double, std::milli>(
+					  std::chrono::steady_clock::now() - beg)
+					                 .count();
+				}
+			}
+			catch (...) {
+				std::lock_guard<std::mutex> lock(error_mutex);
+				if (!error) {
+					error = std::current_exception();
+				}
+				next = total;
+			}
+		};
+		const auto beg = std::chrono::steady_clock::now();
+		std::vector<std::thread> pool;
+		for (size_t w = 1; w < workers.size(); ++w) {
+			pool.emplace_back(work, workers[w]);
+		}
+		work(workers[0]);
+		for (auto& t : pool) {
+			t.join();
+		}
+		const double secs = std::chrono::duration<double>(
+		  std::chrono::steady_clock::now() - beg)
+		                      .count();
+		if (error) {
+			std::rethrow_exception(error);
+		}
+
+		size_t bytes = 0;
+		for (const auto& request : requests) {
+			bytes += request.size();
+		}
+		bytes *= repeat;
+		std::sort(latencies.begin(), latencies.end());
+		const auto& names = pipeline->stats();
+
+		std::cout << std::fixed << std::setprecision(3) << "{"
+		          << json::key(u"stages_timed") << "["
+		          << json::str(names[from].name) << ","
+		          << json::str(names[to - 1].name) << "]"
+		          << ",\"concurrency\":" << concurrency
+		          << ",\"requests\":" << total << ",\"bytes\":" << bytes
+		          << ",\"seconds\":" << secs << ",\"requests_per_sec\":"
+		          << (secs > 0 ? total / secs : 0)
+		          << ",\"mb_per_sec\":" << (secs > 0 ? bytes / secs / 1e6 : 0)
+		          << ",\"latency_ms\":{\"p50\":" << percentile(latencies, 50)
+		          << ",\"p95\":" << percentile(latencies, 95)
+		          << ",\"p99\":" << percentile(latencies, 99) << ",\"max\":"
+		          << (latencies.empty() ? 0 : latencies.back()) << "}"
+		          << ",\"peak_rss_kb\":" << peakRssKb();
+		if (profile) {
+			std::vector<StageStats> stats = pipeline->stats();
+			for (const auto& clone : clones) {
+				const auto& cs = clone->stats();
+				for (size_t i = 0; i < stats.size(); ++i) {
+					divvun::addStageStats(stats[i], cs[i]);
+				}
+			}
+			std::cout << ",\"stages\":[";
+			for (size_t i = from; i < to; ++i) {
+				std::cout << (i == from ? "" : ",");
+				printStageJson(std::cout, stats[i]);
+			}
+			std::cout << "]";
+		}
+		std::cout << "}" << std::endl;
+		return EXIT_SUCCESS;
+	}
+	catch (const cxxopts::OptionException& e) {
+		std::cerr << argv[0] << " ERROR: couldn't parse options: " << e.what()
+		          << std::endl;
+		return EXIT_FAILURE;
+	}
+	catch (const std::runtime_error& e) {
+		std::cerr << e.what() << std::endl;
+		return EXIT_FAILURE;
+	}
+}
@@ -21,9 +21,12 @@
 
 #include "checker.hpp"
 #include "pipeline.hpp"
+#include "server.hpp"
 #include "version.hpp"
 #include "cxxopts.hpp"
 
+#include <iomanip>
+
 using divvun::fromUtf8;
 using divvun::Nothing;
 using divvun::Pipeline;
@@ -108,6 +111,59 @@ int run(Pipeline& pipeline) {
 	return EXIT_SUCCESS;
 }
 
+int runPipelined(Pipeline& pipeline) {
+	pipeline.setPipelined(true);
+	pipeline.proc_stream(
+	  [](std::string& line) { return bool(std::getline(std::cin, line)); },
+	  [](const std::string& out) { std::cout << out << std::endl; });
+	return EXIT_SUCCESS;
+}
+
+void printStats(const std::vector<divvun::StageStats>& stats) {
+	double total = 0;
+	for (const auto& st : stats) {
+		total += st.wall_secs;
+	}
+	std::cerr << std::left << std::setw(32) << "stage" << std::right
+	          << std::setw(8) << "calls" << std::setw(10) << "wall s"
+	          << std::setw(7) << "%" << std::setw(10) << "cpu s"
+	          << std::setw(10) << "max ms" << std::setw(11) << "bytes in"
+	          << std::setw(11) << "bytes out" << std::setw(9) << "cohorts"
+	          << std::setw(10) << "readings" << std::endl;
+	for (const auto& st : stats) {
+		std::cerr << std::left << std::setw(32) << st.name << std::right
+		          << std::fixed << std::setprecision(3) << std::setw(8)
+		          << st.calls << std::setw(10) << st.wall_secs
+		          << std::setprecision(1) << std::setw(7)
+		          << (total > 0 ? 100 * st.wall_secs / total : 0)
+		          << std::setprecision(3) << std::setw(10) << st.cpu_secs
+		          << std::setw(10) << 1000 * st.max_wall_secs << std::setw(11)
+		          << st.bytes_in << std::setw(11) << st.bytes_out
+		          << std::setw(9) << st.cohorts_out << std::setw(10)
+		          << st.readings_out << std::endl;
+	}
+}
+
+// Serve framed requests on stdin/stdout, or on a Unix-domain socket if
+// --socket was given, with --workers clones of pipeline; prints the
+// stats of all of them with --profile
+int runServer(Pipeline& pipeline, cxxopts::Options& options) {
+	const size_t workers =
+	  options.count("workers") ? options["workers"].as<size_t>() : 1;
+	divvun::Server server(pipeline, workers);
+	if (options.count("socket")) {
+		server.listen(options["socket"].as<std::string>());
+	}
+	else {
+		server.serve(STDIN_FILENO, STDOUT_FILENO);
+	}
+	if (options.count("profile")) {
+		// Before the clones, and their stats, go with the server
+		printStats(server.stats());
+	}
+	return EXIT_SUCCESS;
+}
+
 void printPrefs(const Pipeline& pipeline) {
 	using namespace divvun;
 	std::cout << "== Available preferences ==" << std::endl;
@@ -162,7 +218,19 @@ int main(int argc, char** argv) {
 		  cxxopts::value<std::string>(), "FILE")("z,null-flush",
 		  "(Ignored, we always flush on <STREAMCMD:FLUSH>, outputting \\0 "
 		  "when format is json).")("p,preferences",
-		  "Print the preferences defined by the given pipeline")(
+		  "Print the preferences defined by the given pipeline")("pipelined",
+		  "Run each pipeline command in its own thread, passing lines "
+		  "from one command to the next while later lines are read")(
+		  "profile", "Print time spent and data passed per pipeline command "
+		  "to stderr when done")("trace-out", "Write a Chrome trace event "
+		  "file with a span per line and pipeline command (default: "
+		  "$DIVVUN_TRACE_OUT)", cxxopts::value<std::string>(), "FILE")(
+		  "server", "Serve requests framed as \"ID LENGTH\\n\" followed by "
+		  "text on stdin, answering on stdout, until stdin is closed")(
+		  "socket", "Serve framed requests on connections to a Unix-domain "
+		  "socket at PATH", cxxopts::value<std::string>(), "PATH")(
+		  "j,workers", "How many requests --server/--socket may run at once "
+		  "(default: 1)", cxxopts::value<size_t>(), "N")(
 		  "v,verbose", "Be verbose")("t,trace", "Be verbose")(
 		  "V,version", "Version information")("h,help", "Print help");
 
@@ -196,6 +264,7 @@ int main(int argc, char** argv) {
 
 		bool verbose = options.count("v");
 		bool trace = options.count("t");
+		const bool serving = options.count("server") || options.count("socket");
 
 		auto ignores = std::set<divvun::ErrId>();
 		auto includes = std::set<divvun::ErrId>();
@@ -239,12 +308,25 @@ int main(int argc, char** argv) {
 					}
 					if constexpr (std::is_same_v<T, Pipeline>) {
 						arg.setIgnores(ignores);
+						arg.setProfile(options.count("profile"));
+						if (options.count("trace-out")) {
+							arg.setTraceOut(options["trace-out"].as<std::string>());
+						}
 						if (options.count("preferences")) {
 							printPrefs(arg);
 						}
+						else if (serving) {
+							runServer(arg, options);
+						}
+						else if (options.count("pipelined")) {
+							runPipelined(arg);
+						}
 						else {
 							run(arg);
 						}
+						if (options.count("profile") && !serving) {
+							printStats(arg.stats());
+						}
 						return EXIT_SUCCESS;
 					}
 				}, getPipelineXml(specfile, pipename, verbose, trace));
@@ -273,12 +355,25 @@ int main(int argc, char** argv) {
 					if constexpr (std::is_same_v<T, Pipeline>) {
 						arg.setIgnores(ignores);
 						arg.setIncludes(includes);
+						arg.setProfile(options.count("profile"));
+						if (options.count("trace-out")) {
+							arg.setTraceOut(options["trace-out"].as<std::string>());
+						}
 						if (options.count("preferences")) {
 							printPrefs(arg);
 						}
+						else if (serving) {
+							runServer(arg, options);
+						}
+						else if (options.count("pipelined")) {
+							runPipelined(arg);
+						}
 						else {
 							run(arg);
 						}
+						if (options.count("profile") && !serving) {
+							printStats(arg.stats());
+						}
 						return EXIT_SUCCESS;
 					}
 				}, getPipelineAr(archive, pipename, verbose, trace));
@@ -313,12 +408,25 @@ int main(int argc, char** argv) {
 					if constexpr (std::is_same_v<T, Pipeline>) {
 						arg.setIgnores(ignores);
 						arg.setIncludes(includes);
+						arg.setProfile(options.count("profile"));
+						if (options.count("trace-out")) {
+							arg.setTraceOut(options["trace-out"].as<std::string>());
+						}
 						if (options.count("preferences")) {
 							printPrefs(arg);
 						}
+						else if (serving) {
+							runServer(arg, options);
+						}
+						else if (options.count("pipelined")) {
+							runPipelined(arg);
+						}
 						else {
 							run(arg);
 						}
+						if (options.count("profile") && !serving) {
+							printStats(arg.stats());
+						}
 						return EXIT_SUCCESS;
 					}
 				}, getPipelineAr(archive, pipename, verbose, trace));
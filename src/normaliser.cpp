@@ -23,9 +23,9 @@ Normaliser::Normaliser(const hfst::HfstTransducer* generator_,
   const hfst::HfstTransducer* sanalyser_,
   const hfst::HfstTransducer* danalyser_, bool verbose_, bool trace_,
   bool debug_)
-  : generator(generator_)
-  , sanalyser(sanalyser_)
-  , danalyser(danalyser_)
+  : generator(shareTransducer(generator_))
+  , sanalyser(shareTransducer(sanalyser_))
+  , danalyser(shareTransducer(danalyser_))
   , verbose(verbose_)
   , trace(trace_)
   , debug(debug_) {}
@@ -48,22 +48,19 @@ Normaliser::Normaliser(const string& generator_, const string& sanalyser_,
 		std::cout << "* " << generator_ << std::endl;
 	}
 	if (generator_ != "") {
-		generator = std::unique_ptr<const hfst::HfstTransducer>(
-		  (readTransducer(generator_)));
+		generator = shareTransducer(readTransducer(generator_));
 	}
 	if (verbose_) {
 		std::cout << "* " << sanalyser_ << std::endl;
 	}
 	if (sanalyser_ != "") {
-		sanalyser = std::unique_ptr<const hfst::HfstTransducer>(
-		  (readTransducer(sanalyser_)));
+		sanalyser = shareTransducer(readTransducer(sanalyser_));
 	}
 	if (verbose_) {
 		std::cout << "* " << danalyser_ << std::endl;
 	}
 	if (danalyser_ != "") {
-		danalyser = std::unique_ptr<const hfst::HfstTransducer>(
-		  (readTransducer(danalyser_)));
+		danalyser = shareTransducer(readTransducer(danalyser_));
 	}
 	verbose = verbose_;
 }
@@ -73,8 +70,7 @@ void Normaliser::addNormaliser(
 	if (verbose) {
 		std::cout << "adding HFST transducer for tag " << tag << std::endl;
 	}
-	normalisers[tag] =
-	  std::unique_ptr<const hfst::HfstTransducer>(nromaliser_);
+	normalisers[tag] = shareTransducer(nromaliser_);
 }
 
 void Normaliser::addNormaliser(
@@ -83,15 +79,14 @@ void Normaliser::addNormaliser(
 		std::cout << "REading " << normaliser_ << " for tag " << tag
 		          << std::endl;
 	}
-	normalisers[tag] =
-	  std::unique_ptr<const hfst::HfstTransducer>(readTransducer(normaliser_));
+	normalisers[tag] = shareTransducer(readTransducer(normaliser_));
 }
 
 void Normaliser::mangle_reading(CGReading& reading, std::ostream& os) {
 	string outstring = string(reading.reading);
 	string surf = ""; // XXX
-	std::match_results<const char*> result;
-	std::regex_match(outstring.c_str(), result, CG_LINE);
+	// Copied, since outstring is changed below:
+	const string tags = string(lexCGLine(outstring.c_str()).readings);
 	auto tabstart = outstring.find("\t");
 	auto tabend = outstring.find("\"");
 	auto tabs = outstring.substr(tabstart, tabend);
@@ -187,7 +182,7 @@ void Normaliser::mangle_reading(CGReading& reading, std::ostream& os) {
 			}
 			std::string phon = form.str();
 			std::string newlemma = form.str();
-			std::string reanal = result[CG_GROUP_READINGS].str();
+			std::string reanal = tags;
 			// 2. generate specific form with new lemma
 			std::string regen = form.str();
 			std::string regentags = "";
@@ -419,7 +414,7 @@ void Normaliser::mangle_reading(CGReading& reading, std::ostream& os) {
 		std::string phon = reading.lemma.substr(1, reading.lemma.length() - 2);
 		std::string newlemma =
 		  reading.lemma.substr(1, reading.lemma.length() - 2);
-		std::string reanal = result[CG_GROUP_READINGS].str();
+		std::string reanal = tags;
 		// 2. generate specific form with new lemma
 		std::string regen =
 		  reading.lemma.substr(1, reading.lemma.length() - 2);
@@ -717,27 +712,25 @@ void Normaliser::run(std::istream& is, std::ostream& os) {
 	CGReading* lastreading = nullptr;
 	string lasttabs = "\t\t\t";
 	for (string line; std::getline(is, line);) {
-		std::match_results<const char*> result;
-		std::regex_match(line.c_str(), result, CG_LINE);
-		if ((!result.empty()) && (result[CG_GROUP_SURF].length() != 0)) {
+		const CGLine cg = lexCGLine(line.c_str());
+		if (!cg.surf.empty()) {
 			if (cohort != nullptr) {
 				process_cohort(*cohort, os);
 				delete cohort;
 			}
 			if (debug) {
-				std::cout << "New surface form: " << result[CG_GROUP_SURF]
-				          << std::endl;
+				std::cout << "New surface form: " << cg.surf << std::endl;
 			}
 			cohort = new CGCohort;
-			cohort->surf = string(result[0]) + "\n";
+			cohort->surf = string(cg.all) + "\n";
 		}
-		else if ((!result.empty()) && (result[CG_GROUP_LEMMA].length() != 0)) {
+		else if (!cg.lemma.empty()) {
 			CGReading* newreading = new CGReading;
-			newreading->reading = string(result[0]) + "\n";
-			newreading->lemma = result[CG_GROUP_LEMMA];
-			string tabs = result[CG_GROUP_SUBS];
+			newreading->reading = string(cg.all) + "\n";
+			newreading->lemma = cg.lemma;
+			string tabs = string(cg.subs);
 			if (debug) {
-				std::cout << "New lemma: " << result[CG_GROUP_LEMMA];
+				std::cout << "New lemma: " << cg.lemma;
 			}
 			if (tabs.length() > lasttabs.length()) {
 				if (debug) {
@@ -752,7 +745,7 @@ void Normaliser::run(std::istream& is, std::ostream& os) {
 				cohort->readings.push_back(newreading);
 			}
 			lastreading = newreading;
-			lasttabs = result[CG_GROUP_SUBS];
+			lasttabs = cg.subs;
 		}
 		else {
 			if (cohort != nullptr) {
@@ -763,7 +756,7 @@ void Normaliser::run(std::istream& is, std::ostream& os) {
 			if (debug) {
 				std::cout << "Probably not cg formatted stuff: " << std::endl;
 			}
-			os << result[0] << std::endl;
+			os << cg.all << std::endl;
 		}
 	}
 }
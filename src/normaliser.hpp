@@ -51,17 +51,25 @@ public:
 	  const std::string& tag, const hfst::HfstTransducer* normaliser);
 	void addNormaliser(const std::string& tag, const std::string& normaliser);
 	/*const*/ void run(std::istream& is, std::ostream& os);
+	void setWorkers(size_t workers) {
+		for (const auto& n : normalisers) {
+			divvun::setWorkers(n.second, workers);
+		}
+		divvun::setWorkers(generator, workers);
+		divvun::setWorkers(sanalyser, workers);
+		divvun::setWorkers(danalyser, workers);
+	}
 
 private:
 	void process_cohort(CGCohort& cohort, std::ostream& os);
 	void process_reading(CGReading& reading, std::ostream& os);
 	std::string process_subreading(CGReading& subreading, std::ostream& os);
 	void mangle_reading(CGReading& reading, std::ostream& os);
-	std::map<std::string, std::unique_ptr<const hfst::HfstTransducer>>
+	std::map<std::string, std::shared_ptr<const SharedTransducer>>
 	  normalisers;
-	unique_ptr<const hfst::HfstTransducer> generator;
-	unique_ptr<const hfst::HfstTransducer> sanalyser;
-	unique_ptr<const hfst::HfstTransducer> danalyser;
+	std::shared_ptr<const SharedTransducer> generator;
+	std::shared_ptr<const SharedTransducer> sanalyser;
+	std::shared_ptr<const SharedTransducer> danalyser;
 	bool verbose;
 	bool trace;
 	bool debug;
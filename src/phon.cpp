@@ -20,7 +20,7 @@
 namespace divvun {
 
 Phon::Phon(const hfst::HfstTransducer* text2ipa_, bool verbose_, bool trace_)
-  : text2ipa(text2ipa_)
+  : text2ipa(shareTransducer(text2ipa_))
   , altText2ipas()
   , verbose(verbose_)
   , trace(trace_) {
@@ -34,8 +34,7 @@ Phon::Phon(const std::string& text2ipa_, bool verbose_, bool trace_) {
 	if (verbose_) {
 		std::cout << "Reading: " << text2ipa_ << std::endl;
 	}
-	text2ipa =
-	  std::unique_ptr<const hfst::HfstTransducer>((readTransducer(text2ipa_)));
+	text2ipa = shareTransducer(readTransducer(text2ipa_));
 	verbose = verbose_;
 	trace = trace_;
 }
@@ -45,7 +44,7 @@ void Phon::addAlternateText2ipa(
 	if (verbose) {
 		std::cout << "adding HFST transducer for tag " << tag << std::endl;
 	}
-	altText2ipas[tag] = std::unique_ptr<const hfst::HfstTransducer>(text2ipa_);
+	altText2ipas[tag] = shareTransducer(text2ipa_);
 }
 
 void Phon::addAlternateText2ipa(
@@ -54,8 +53,7 @@ void Phon::addAlternateText2ipa(
 		std::cout << "Reading " << text2ipa_ << " for tag " << tag
 		          << std::endl;
 	}
-	altText2ipas[tag] =
-	  std::unique_ptr<const hfst::HfstTransducer>(readTransducer(text2ipa_));
+	altText2ipas[tag] = shareTransducer(readTransducer(text2ipa_));
 	assert(altText2ipas[tag]);
 }
 
@@ -253,28 +251,26 @@ void Phon::run(std::istream& is, std::ostream& os) {
 	CGReading* lastreading = nullptr;
 	string lasttabs = "\t\t\t";
 	for (string line; std::getline(is, line);) {
-		std::match_results<const char*> result;
-		std::regex_match(line.c_str(), result, CG_LINE);
-		if ((!result.empty()) && (result[CG_GROUP_SURF].length() != 0)) {
+		const CGLine cg = lexCGLine(line.c_str());
+		if (!cg.surf.empty()) {
 			if (cohort != nullptr) {
 				process_cohort(*cohort, os);
 				delete cohort;
 			}
 			if (verbose) {
-				std::cout << "New surface form: " << result[CG_GROUP_SURF]
-				          << std::endl;
+				std::cout << "New surface form: " << cg.surf << std::endl;
 			}
 			cohort = new CGCohort;
-			cohort->surf = string(result[0]);
+			cohort->surf = string(cg.all);
 			// os << result[0] << std::endl;
 		}
-		else if ((!result.empty()) && (result[CG_GROUP_LEMMA].length() != 0)) {
+		else if (!cg.lemma.empty()) {
 			CGReading* newreading = new CGReading;
-			newreading->reading = string(result[0]) + "\n";
-			newreading->lemma = result[CG_GROUP_LEMMA];
-			string tabs = result[CG_GROUP_SUBS];
+			newreading->reading = string(cg.all) + "\n";
+			newreading->lemma = cg.lemma;
+			string tabs = string(cg.subs);
 			if (verbose) {
-				std::cout << "New lemma: " << result[CG_GROUP_LEMMA];
+				std::cout << "New lemma: " << cg.lemma;
 			}
 			if (tabs.length() > lasttabs.length()) {
 				if (verbose) {
@@ -289,18 +285,18 @@ void Phon::run(std::istream& is, std::ostream& os) {
 				cohort->readings.push_back(newreading);
 			}
 			lastreading = newreading;
-			lasttabs = result[CG_GROUP_SUBS];
+			lasttabs = cg.subs;
 		}
 		else {
 			if (verbose) {
-				if (result[0].str()[0] == ';') {
+				if (!cg.all.empty() && cg.all[0] == ';') {
 					std::cout << "Skipping traced removed CG line:"
 					          << std::endl;
 				}
-				else if (result[0].str()[0] == ':') {
+				else if (!cg.all.empty() && cg.all[0] == ':') {
 					std::cout << "Skipping superblanks:" << std::endl;
 				}
-				else if (result[0].str() == "") {
+				else if (cg.all.empty()) {
 					std::cout << "Blanks:" << std::endl;
 				}
 				else {
@@ -308,7 +304,7 @@ void Phon::run(std::istream& is, std::ostream& os) {
 					          << std::endl;
 				}
 			}
-			os << result[0] << std::endl;
+			os << cg.all << std::endl;
 		}
 	}
 }
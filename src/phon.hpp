@@ -46,6 +46,12 @@ public:
 	void addAlternateText2ipa(
 	  const std::string& tag, const std::string& text2ipa);
 	/*const*/ void run(std::istream& is, std::ostream& os);
+	void setWorkers(size_t workers) {
+		divvun::setWorkers(text2ipa, workers);
+		for (const auto& t : altText2ipas) {
+			divvun::setWorkers(t.second, workers);
+		}
+	}
 
 private:
 	void process_cohort(CGCohort& cohort, std::ostream& os);
@@ -55,8 +61,8 @@ private:
 	  CGReading& subreading, const CGCohort& cohort, std::ostream& os);
 	void mangle_reading(
 	  CGReading& reading, const CGCohort& cohort, std::ostream& os);
-	std::unique_ptr<const hfst::HfstTransducer> text2ipa;
-	std::map<std::string, std::unique_ptr<const hfst::HfstTransducer>>
+	std::shared_ptr<const SharedTransducer> text2ipa;
+	std::map<std::string, std::shared_ptr<const SharedTransducer>>
 	  altText2ipas;
 	bool verbose;
 	bool trace;
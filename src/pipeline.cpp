@@ -15,7 +15,19 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  */
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
 #include <cstdlib>
+#include <ctime>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <csignal>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/wait.h>
 
 #include "pipeline.hpp"
 
@@ -27,8 +39,15 @@ void dbg(const string& label, stringstream& output) {
 	output.seekg(p, output.beg);
 }
 
-hfst_ol::PmatchContainer* TokenizeCmd::mkContainer(
-  std::istream& instream, int weight_classes, bool verbose) {
+static std::unique_ptr<hfst_ol::PmatchContainer> readContainer(
+  const SharedBytes& bytes, bool verbose) {
+	OneShotReadBuf osrb(const_cast<char*>(bytes.data.get()), bytes.size);
+	std::istream is(&osrb);
+	std::unique_ptr<hfst_ol::PmatchContainer> c(new hfst_ol::PmatchContainer(is));
+	c->set_verbose(verbose);
+	return c;
+}
+TokenizeCmd::TokenizeCmd(SharedBytes bytes, int weight_classes, bool verbose) {
 	settings.output_format = hfst_ol_tokenize::giellacg;
 	settings.tokenize_multichar =
 	  false; // TODO: https://github.com/hfst/hfst/issues/367#issuecomment-334922284
@@ -36,19 +55,35 @@ hfst_ol::PmatchContainer* TokenizeCmd::mkContainer(
 	settings.print_all = true;
 	settings.dedupe = true;
 	settings.max_weight_classes = weight_classes;
-	auto* c = new hfst_ol::PmatchContainer(instream);
-	c->set_verbose(verbose);
-	return c;
+	containers = std::make_shared<Pool<hfst_ol::PmatchContainer>>(
+	  readContainer(bytes, verbose),
+	  [bytes, verbose](hfst_ol::PmatchContainer&) {
+		  return readContainer(bytes, verbose);
+	  });
+}
+static SharedBytes readAll(std::istream&& is) {
+	return copyBytes(
+	  string(std::istreambuf_iterator<char>(is), std::istreambuf_iterator<char>()));
 }
 TokenizeCmd::TokenizeCmd(
   std::istream& instream, int weight_classes, bool verbose)
-  : container(mkContainer(instream, weight_classes, verbose)) {}
+  : TokenizeCmd(readAll(std::move(instream)), weight_classes, verbose) {}
 TokenizeCmd::TokenizeCmd(const string& path, int weight_classes, bool verbose)
-  : istream(unique_ptr<std::istream>(new std::ifstream(path.c_str())))
-  , container(mkContainer(*istream, weight_classes, verbose)) {}
+  : TokenizeCmd(readAll(std::ifstream(path.c_str())), weight_classes, verbose) {}
+TokenizeCmd::TokenizeCmd(const TokenizeCmd& other)
+  : PipeCmd()
+  , settings(other.settings)
+  , containers(other.containers) {}
 void TokenizeCmd::run(stringstream& input, stringstream& output) const {
+	const auto container = containers->take();
 	hfst_ol_tokenize::process_input(*container, input, output, settings);
 }
+void TokenizeCmd::setWorkers(size_t workers) {
+	containers->setMax(workers);
+}
+unique_ptr<PipeCmd> TokenizeCmd::clone() const {
+	return unique_ptr<PipeCmd>(new TokenizeCmd(*this));
+}
 
 
 MweSplitCmd::MweSplitCmd(bool verbose)
@@ -57,6 +92,9 @@ void MweSplitCmd::run(stringstream& input, stringstream& output) const {
 	cg3_run_mwesplit_on_text(
 	  applicator.get(), (std_istream*)&input, (std_ostream*)&output);
 }
+unique_ptr<PipeCmd> MweSplitCmd::clone() const {
+	return unique_ptr<PipeCmd>(new MweSplitCmd(false));
+}
 
 NormaliseCmd::NormaliseCmd(const hfst::HfstTransducer* generator,
   const hfst::HfstTransducer* analyser,
@@ -77,14 +115,25 @@ NormaliseCmd::NormaliseCmd(const string& generator, const string& analyser,
 	}
 }
 
+NormaliseCmd::NormaliseCmd(Normaliser* normaliser_)
+  : normaliser(normaliser_) {}
+
 void NormaliseCmd::run(stringstream& input, stringstream& output) const {
 	normaliser->run(input, output);
 }
+void NormaliseCmd::setWorkers(size_t workers) {
+	normaliser->setWorkers(workers);
+}
+unique_ptr<PipeCmd> NormaliseCmd::clone() const {
+	return unique_ptr<PipeCmd>(
+	  new NormaliseCmd(new Normaliser(*normaliser)));
+}
 
 
 CGCmd::CGCmd(const char* buff, const size_t size, bool verbose, bool trace)
-  : grammar(cg3_grammar_load_buffer(buff, size))
-  , applicator(cg3_applicator_create(grammar.get())) {
+  : grammar(cg3_grammar_load_buffer(buff, size), CGGrammarDeleter())
+  , applicator(cg3_applicator_create(grammar.get()))
+  , trace(trace) {
 	if (!grammar) {
 		throw std::runtime_error("libdivvun: ERROR: Couldn't load CG grammar");
 	}
@@ -93,8 +142,9 @@ CGCmd::CGCmd(const char* buff, const size_t size, bool verbose, bool trace)
 	}
 }
 CGCmd::CGCmd(const string& path, bool verbose, bool trace)
-  : grammar(cg3_grammar_load(path.c_str()))
-  , applicator(cg3_applicator_create(grammar.get())) {
+  : grammar(cg3_grammar_load(path.c_str()), CGGrammarDeleter())
+  , applicator(cg3_applicator_create(grammar.get()))
+  , trace(trace) {
 	if (!grammar) {
 		throw std::runtime_error(
 		  ("libdivvun: ERROR: Couldn't load CG grammar " + path).c_str());
@@ -103,10 +153,21 @@ CGCmd::CGCmd(const string& path, bool verbose, bool trace)
 		cg3_applicator_setflags(applicator.get(), CG3F_TRACE);
 	}
 }
+CGCmd::CGCmd(std::shared_ptr<cg3_grammar> grammar_, bool trace)
+  : grammar(std::move(grammar_))
+  , applicator(cg3_applicator_create(grammar.get()))
+  , trace(trace) {
+	if (trace) {
+		cg3_applicator_setflags(applicator.get(), CG3F_TRACE);
+	}
+}
 void CGCmd::run(stringstream& input, stringstream& output) const {
 	cg3_run_grammar_on_text(
 	  applicator.get(), (std_istream*)&input, (std_ostream*)&output);
 }
+unique_ptr<PipeCmd> CGCmd::clone() const {
+	return unique_ptr<PipeCmd>(new CGCmd(grammar, trace));
+}
 
 #ifdef HAVE_CGSPELL
 CGSpellCmd::CGSpellCmd(hfst_ospell::Transducer* errmodel,
@@ -130,18 +191,31 @@ CGSpellCmd::CGSpellCmd(const string& err_path, const string& lex_path,
   : speller(
       new Speller(err_path, lex_path, verbose, max_analysis_weight, max_weight,
         real_word, limit, beam, time_cutoff, max_sent_unknown_rate)) {}
+CGSpellCmd::CGSpellCmd(Speller* speller_)
+  : speller(speller_) {}
 void CGSpellCmd::run(stringstream& input, stringstream& output) const {
 	divvun::run_cgspell(input, output, *speller);
 }
+unique_ptr<PipeCmd> CGSpellCmd::clone() const {
+	return unique_ptr<PipeCmd>(new CGSpellCmd(speller->clone()));
+}
 #endif
 
 BlanktagCmd::BlanktagCmd(const hfst::HfstTransducer* analyser, bool verbose)
   : blanktag(new Blanktag(analyser, verbose)) {}
 BlanktagCmd::BlanktagCmd(const string& ana_path, bool verbose)
   : blanktag(new Blanktag(ana_path, verbose)) {}
+BlanktagCmd::BlanktagCmd(Blanktag* blanktag_)
+  : blanktag(blanktag_) {}
 void BlanktagCmd::run(stringstream& input, stringstream& output) const {
 	blanktag->run(input, output);
 }
+void BlanktagCmd::setWorkers(size_t workers) {
+	blanktag->setWorkers(workers);
+}
+unique_ptr<PipeCmd> BlanktagCmd::clone() const {
+	return unique_ptr<PipeCmd>(new BlanktagCmd(new Blanktag(*blanktag)));
+}
 
 PhonCmd::PhonCmd(const hfst::HfstTransducer* analyser,
   const std::map<string, const hfst::HfstTransducer*>& alttagfsas,
@@ -159,9 +233,18 @@ PhonCmd::PhonCmd(const string& ana_path,
 	}
 }
 
+PhonCmd::PhonCmd(Phon* phon_)
+  : phon(phon_) {}
+
 void PhonCmd::run(stringstream& input, stringstream& output) const {
 	phon->run(input, output);
 }
+void PhonCmd::setWorkers(size_t workers) {
+	phon->setWorkers(workers);
+}
+unique_ptr<PipeCmd> PhonCmd::clone() const {
+	return unique_ptr<PipeCmd>(new PhonCmd(new Phon(*phon)));
+}
 
 SuggestCmd::SuggestCmd(const hfst::HfstTransducer* generator,
   divvun::MsgMap msgs, const string& locale, bool verbose,
@@ -175,9 +258,17 @@ SuggestCmd::SuggestCmd(const string& gen_path, const string& msg_path,
 void SuggestCmd::run(stringstream& input, stringstream& output) const {
 	suggest->run(input, output, RunJson);
 }
+SuggestCmd::SuggestCmd(Suggest* suggest_)
+  : suggest(suggest_) {}
 vector<Err> SuggestCmd::run_errs(stringstream& input) const {
 	return suggest->run_errs(input);
 }
+void SuggestCmd::setWorkers(size_t workers) {
+	suggest->setWorkers(workers);
+}
+unique_ptr<PipeCmd> SuggestCmd::clone() const {
+	return unique_ptr<PipeCmd>(new SuggestCmd(new Suggest(*suggest)));
+}
 void SuggestCmd::setIgnores(const std::set<ErrId>& ignores) {
 	suggest->setIgnores(ignores);
 }
@@ -185,11 +276,22 @@ void SuggestCmd::setIncludes(const std::set<ErrId>& includes) {
 	suggest->setIncludes(includes);
 }
 const MsgMap& SuggestCmd::getMsgs() {
-	return suggest->msgs;
+	return *suggest->msgs;
+}
+void SuggestCmd::setGenerationCacheSize(size_t max_bytes) {
+	suggest->setGenerationCacheSize(max_bytes);
+}
+CacheStats SuggestCmd::generationCacheStats() const {
+	return suggest->generationCacheStats();
 }
 
-ShCmd::ShCmd(
-  const string& prog, const std::vector<string>& args, bool verbose) {
+ShCmd::ShCmd(const string& prog_, const std::vector<string>& args_,
+  Flush flush_, int timeout_ms_, bool verbose_)
+  : prog(prog_)
+  , args(args_)
+  , flush(flush_)
+  , timeout_ms(timeout_ms_)
+  , verbose(verbose_) {
 	argv = (char**)malloc(sizeof(char*) * (args.size() * 2 + 2));
 	size_t i = 0;
 	for (auto arg : args) {
@@ -199,7 +301,13 @@ ShCmd::ShCmd(
 }
 
 
+unique_ptr<PipeCmd> ShCmd::clone() const {
+	return unique_ptr<PipeCmd>(
+	  new ShCmd(prog, args, flush, timeout_ms, verbose));
+}
+
 ShCmd::~ShCmd() {
+	stop();
 	size_t i = 0;
 	while (argv[i] != NULL) {
 		free(argv[i++]);
@@ -207,51 +315,291 @@ ShCmd::~ShCmd() {
 	free(argv);
 }
 
-void ShCmd::run(stringstream& input, stringstream& output) const {
-	int fds[2];
+ShCmd::Flush ShCmd::parseFlush(const string& flush) {
+	if (flush.empty() || flush == "nul") {
+		return FlushNul;
+	}
+	if (flush == "streamcmd") {
+		return FlushStreamCmd;
+	}
+	throw std::runtime_error("libdivvun: ERROR: Unknown flush=\"" + flush +
+	                         "\" on <sh> (expected nul or streamcmd)");
+}
+
+int ShCmd::parseTimeout(const pugi::xml_attribute& timeout) {
+	const double secs = timeout.as_double(60);
+	if (secs < 0) {
+		throw std::runtime_error("libdivvun: ERROR: Negative timeout=\"" +
+		                         string(timeout.value()) + "\" on <sh>");
+	}
+	return (int)(secs * 1000);
+}
+
+// We can't ignore SIGPIPE process-wide, since we may be embedded in a
+// program that handles it itself
+ssize_t writeNoSigpipe(int fd, const char* buf, size_t n) {
+#ifdef F_SETNOSIGPIPE
+	// macOS has neither sigtimedwait nor pipe2, but can turn SIGPIPE
+	// off per pipe (done in pipeCloexec)
+	return write(fd, buf, n);
+#else
+	sigset_t sigpipe;
+	sigemptyset(&sigpipe);
+	sigaddset(&sigpipe, SIGPIPE);
+	sigset_t pending;
+	sigpending(&pending);
+	const bool was_pending = sigismember(&pending, SIGPIPE);
+	sigset_t old;
+	pthread_sigmask(SIG_BLOCK, &sigpipe, &old);
+	const ssize_t written = write(fd, buf, n);
+	const int err = errno;
+	if (written < 0 && err == EPIPE && !was_pending) {
+		// Take the SIGPIPE we caused, so it isn't delivered on unblocking:
+		const timespec zero = { 0, 0 };
+		while (sigtimedwait(&sigpipe, nullptr, &zero) == -1 && errno == EINTR) {
+		}
+	}
+	pthread_sigmask(SIG_SETMASK, &old, nullptr);
+	errno = err;
+	return written;
+#endif
+}
+
+// pipe with both ends close-on-exec from the start, so a fork in
+// another thread can't leak them into its program
+static int pipeCloexec(int fds[2]) {
+#ifdef F_SETNOSIGPIPE
 	if (pipe(fds) == -1) {
-		throw std::runtime_error("pipe failed ");
+		return -1;
+	}
+	fcntl(fds[0], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETFD, FD_CLOEXEC);
+	fcntl(fds[1], F_SETNOSIGPIPE, 1);
+	return 0;
+#else
+	return pipe2(fds, O_CLOEXEC);
+#endif
+}
+
+static const string STREAMCMD_FLUSH = "<STREAMCMD:FLUSH>\n";
+
+size_t ShCmd::flushSize() const {
+	return flush == FlushNul ? 1 : STREAMCMD_FLUSH.size();
+}
+
+size_t ShCmd::findFlush(const string& out, size_t n) const {
+	size_t p = 0;
+	for (;; ++p) {
+		p = flush == FlushNul ? out.find('\0', p) : out.find(STREAMCMD_FLUSH, p);
+		if (p == string::npos) {
+			return p;
+		}
+		if (flush == FlushStreamCmd && p > 0 && out[p - 1] != '\n') {
+			continue; // not at the start of a line
+		}
+		if (--n == 0) {
+			return p;
+		}
+	}
+}
+
+void ShCmd::start() const {
+	int in[2];
+	int out[2];
+	// No end should leak into other programs we (or other threads)
+	// start, or they wouldn't see end of input when we close ours; the
+	// child's ends stay open over exec since dup2 clears the flag:
+	if (pipeCloexec(in) == -1) {
+		throw std::runtime_error("libdivvun: ERROR: pipe failed for " + prog);
+	}
+	if (pipeCloexec(out) == -1) {
+		close(in[0]);
+		close(in[1]);
+		throw std::runtime_error("libdivvun: ERROR: pipe failed for " + prog);
+	}
+	pid = fork();
+	if (pid == -1) {
+		close(in[0]);
+		close(in[1]);
+		close(out[0]);
+		close(out[1]);
+		throw std::runtime_error("libdivvun: ERROR: fork failed for " + prog);
 	}
-	pid_t pid = fork();
+	if (pid == 0) {
+		// Only async-signal-safe calls here, we may have other threads
+		dup2(in[0], STDIN_FILENO);
+		dup2(out[1], STDOUT_FILENO);
+		close(in[0]);
+		close(out[1]);
+		execvp(prog.c_str(), argv);
+		_exit(127);
+	}
+	close(in[0]);
+	close(out[1]);
+	to_prog = in[1];
+	from_prog = out[0];
+	fcntl(to_prog, F_SETFL, fcntl(to_prog, F_GETFL) | O_NONBLOCK);
+	if (verbose) {
+		std::cerr << "libdivvun: started " << prog << " (pid " << pid << ")"
+		          << std::endl;
+	}
+}
+
+void ShCmd::stop(bool kill) const {
 	if (pid == -1) {
-		throw std::runtime_error("fork failed ");
+		return;
 	}
-	else if (pid == 0) {
-		close(fds[1]);              // close write
-		dup2(fds[0], STDIN_FILENO); // redirect
-		close(fds[0]);              // close read
-		if (execvp(argv[0], argv) < 0) {
-			throw std::runtime_error("exec failed ");
+	if (kill) {
+		::kill(pid, SIGKILL);
+	}
+	// Otherwise the program should exit when its input ends; if it
+	// doesn't within its timeout (at most a second), it is killed, so
+	// a program ignoring EOF can't hang our destructor
+	close(to_prog);
+	close(from_prog);
+	const int wait_ms = timeout_ms > 0 ? std::min(timeout_ms, 1000) : 1000;
+	const auto deadline =
+	  std::chrono::steady_clock::now() + std::chrono::milliseconds(wait_ms);
+	auto reaped = [this] {
+		pid_t r;
+		while ((r = waitpid(pid, nullptr, WNOHANG)) == -1 && errno == EINTR) {
 		}
-		throw std::runtime_error("child process failed ");
+		return r != 0;
+	};
+	bool exited = reaped();
+	while (!exited && std::chrono::steady_clock::now() < deadline) {
+		std::this_thread::sleep_for(std::chrono::milliseconds(5));
+		exited = reaped();
 	}
-	else {
-		close(fds[0]); // close read
-		char buffin[8192];
-		while (input.getline(buffin, sizeof(buffin))) {
-			size_t readn = input.gcount();
-			if (write(fds[1], buffin, readn) == -1) {
-				throw std::runtime_error("write failed");
+	if (!exited) {
+		::kill(pid, SIGKILL);
+		while (waitpid(pid, nullptr, 0) == -1 && errno == EINTR) {
+		}
+	}
+	pid = -1;
+	to_prog = -1;
+	from_prog = -1;
+	pending.clear();
+}
+
+void ShCmd::run(stringstream& input, stringstream& output) const {
+	if (pid == -1) {
+		start();
+	}
+	string req = input.str();
+	if (flush == FlushStreamCmd && !req.empty() && req.back() != '\n') {
+		req += '\n';
+	}
+	// A program echoes every flush, including any in the input, so we
+	// read until we have had all of those and our own:
+	size_t flushes = 1;
+	while (findFlush(req, flushes) != string::npos) {
+		++flushes;
+	}
+	req += flush == FlushNul ? string(1, '\0') : STREAMCMD_FLUSH;
+	// Write and read at the same time, so neither of us blocks on a
+	// full pipe while the other waits:
+	string out;
+	out.swap(pending);
+	size_t written = 0;
+	size_t end;
+	char buf[65536];
+	while ((end = findFlush(out, flushes)) == string::npos) {
+		pollfd fds[2] = { { from_prog, POLLIN, 0 }, { to_prog, POLLOUT, 0 } };
+		const nfds_t nfds = written < req.size() ? 2 : 1;
+		const int ready = poll(fds, nfds, timeout_ms > 0 ? timeout_ms : -1);
+		if (ready == 0) {
+			stop(true);
+			throw std::runtime_error("libdivvun: ERROR: " + prog +
+			                         " gave no output for " +
+			                         std::to_string(timeout_ms) +
+			                         "ms; does it echo each flush it reads, "
+			                         "without buffering its output?");
+		}
+		if (ready == -1) {
+			if (errno == EINTR) {
+				continue;
+			}
+			stop(true);
+			throw std::runtime_error("libdivvun: ERROR: poll failed for " + prog);
+		}
+		if (nfds == 2 && fds[1].revents != 0) {
+			const ssize_t n = writeNoSigpipe(
+			  to_prog, req.data() + written, req.size() - written);
+			if (n > 0) {
+				written += n;
+			}
+			else if (n == 0 || (errno != EINTR && errno != EAGAIN)) {
+				stop(true);
+				throw std::runtime_error(
+				  "libdivvun: ERROR: couldn't write to " + prog);
 			}
 		}
-		close(fds[1]); // close write
-		char buffout[8192];
-		ssize_t count;
-		while ((count = read(fds[1], buffout, sizeof(buffout))) > 0) {
-			output.write(buffout, count);
+		if (fds[0].revents != 0) {
+			const ssize_t n = read(from_prog, buf, sizeof(buf));
+			if (n > 0) {
+				out.append(buf, n);
+			}
+			else if (n == 0 || (errno != EINTR && errno != EAGAIN)) {
+				stop(true);
+				throw std::runtime_error("libdivvun: ERROR: " + prog +
+				                         " exited without answering; does it "
+				                         "echo each flush it reads?");
+			}
 		}
 	}
-	//wait(0); // wait
+	output.write(out.data(), end);
+	pending = out.substr(end + flushSize());
 }
 
 
-Pipeline::Pipeline(LocalisedPrefs prefs_, vector<unique_ptr<PipeCmd>> cmds_,
+Pipeline::Pipeline(std::shared_ptr<const LocalisedPrefs> prefs_,
+  vector<unique_ptr<PipeCmd>> cmds_, const vector<string>& stage_names,
   SuggestCmd* suggestcmd_, bool verbose_, bool trace_)
   : verbose(verbose_)
   , trace(trace_)
-  , prefs(std::move(prefs_))
+  , shared_prefs(std::move(prefs_))
+  , prefs(*shared_prefs)
+  , stage_stats(stage_names.size())
+  , tracer(TraceWriter::fromEnv())
+  , workers(std::make_shared<Workers>())
   , cmds(std::move(cmds_))
-  , suggestcmd(suggestcmd_) {};
+  , suggestcmd(suggestcmd_) {
+	for (size_t i = 0; i < stage_names.size(); ++i) {
+		stage_stats[i].name = stage_names[i];
+	}
+};
+
+Pipeline::~Pipeline() {
+	if (workers) { // not moved from
+		countWorkers(false);
+	}
+}
+
+void Pipeline::countWorkers(bool added) {
+	std::lock_guard<std::mutex> lock(workers->mutex);
+	workers->count = added ? workers->count + 1 : workers->count - 1;
+	// The commands share their models with those of the clones, so
+	// telling ours is enough:
+	for (auto& cmd : cmds) {
+		cmd->setWorkers(workers->count);
+	}
+}
+
+// How a pipespec command is named in StageStats, e.g. "cg valency.bin"
+string stageName(const pugi::xml_node& cmd) {
+	const string name = cmd.name();
+	if (name == "sh") {
+		return name + " " + cmd.attribute("prog").value();
+	}
+	for (const pugi::xml_node& arg : cmd.children()) {
+		const string n = arg.attribute("n").value();
+		if (!n.empty()) {
+			return name + " " + n;
+		}
+	}
+	return name;
+}
 
 Pipeline::Pipeline(const unique_ptr<PipeSpec>& spec, const u16string& pipename,
   bool verbose, bool trace)
@@ -265,6 +613,7 @@ Pipeline Pipeline::mkPipeline(const unique_ptr<ArPipeSpec>& ar_spec,
   const u16string& pipename, bool verbose, bool trace) {
 	LocalisedPrefs prefs;
 	vector<unique_ptr<PipeCmd>> cmds;
+	vector<string> stage_names;
 	SuggestCmd* suggestcmd = nullptr;
 	auto& spec = ar_spec->spec;
 	if (!cg3_init(stdin, stdout, stderr)) {
@@ -273,7 +622,23 @@ Pipeline Pipeline::mkPipeline(const unique_ptr<ArPipeSpec>& ar_spec,
 		  "libdivvun: ERROR: Couldn't initialise ICU for vislcg3!");
 	}
 	string locale = spec->language;
-	for (const pugi::xml_node& cmd : spec->pnodes.at(pipename).children()) {
+	const pugi::xml_node& pipe = spec->pnodes.at(pipename);
+	// Read all the files this pipe needs in one go:
+	std::set<string> entry_names;
+	for (const pugi::xml_node& cmd : pipe.children()) {
+		if (strcmp(cmd.name(), "sh") == 0 ||
+		    strcmp(cmd.name(), "prefs") == 0) {
+			continue;
+		}
+		for (const pugi::xml_node& arg : cmd.children()) {
+			const string n = arg.attribute("n").value();
+			if (!n.empty()) {
+				entry_names.insert(n);
+			}
+		}
+	}
+	const ArIndex index(ar_spec->ar_path, entry_names);
+	for (const pugi::xml_node& cmd : pipe.children()) {
 		const auto& name = fromUtf8(cmd.name());
 		std::unordered_map<string, string> args;
 		for (const pugi::xml_node& arg : cmd.children()) {
@@ -283,24 +648,17 @@ Pipeline Pipeline::mkPipeline(const unique_ptr<ArPipeSpec>& ar_spec,
 		if (name == u"tokenise" || name == u"tokenize") {
 			int weight_classes = cmd.attribute("weight-classes")
 			                       .as_int(std::numeric_limits<int>::max());
-			ArEntryHandler<TokenizeCmd*> f =
-			  [verbose, weight_classes](
-			    const string& ar_path, const void* buff, const size_t size) {
-				  OneShotReadBuf osrb((char*)buff, size);
-				  std::istream is(&osrb);
-				  return new TokenizeCmd(is, weight_classes, verbose);
-			  };
-			TokenizeCmd* s =
-			  readArchiveExtract(ar_spec->ar_path, args["tokenizer"], f);
-			cmds.emplace_back(s);
+			// The tokeniser keeps its bytes, to read more containers from
+			// when clones need them:
+			cmds.emplace_back(new TokenizeCmd(
+			  index.shared(args["tokenizer"]), weight_classes, verbose));
 		}
 		else if (name == u"cg") {
 			ArEntryHandler<CGCmd*> f = [verbose, trace](const string& ar_path,
 			                             const void* buff, const size_t size) {
 				return new CGCmd((char*)buff, size, verbose, trace);
 			};
-			CGCmd* s =
-			  readArchiveExtract(ar_spec->ar_path, args["grammar"], f);
+			CGCmd* s = index.extract(args["grammar"], f);
 			cmds.emplace_back(s);
 		}
 		else if (name == u"cgspell") {
@@ -310,8 +668,8 @@ Pipeline Pipeline::mkPipeline(const unique_ptr<ArPipeSpec>& ar_spec,
 				  return new hfst_ospell::Transducer((char*)buff);
 			  };
 			auto* s = new CGSpellCmd(
-			  readArchiveExtract(ar_spec->ar_path, args["errmodel"], f),
-			  readArchiveExtract(ar_spec->ar_path, args["lexicon"], f),
+			  index.extract(args["errmodel"], f),
+			  index.extract(args["lexicon"], f),
 			  cmd.attribute("limit").as_int(10),
 			  cmd.attribute("beam").as_float(15.0),
 			  cmd.attribute("max-weight").as_float(5000.0),
@@ -337,12 +695,10 @@ Pipeline Pipeline::mkPipeline(const unique_ptr<ArPipeSpec>& ar_spec,
 			auto alttags = cmd.children("alttext2ipa");
 			for (const auto& alttag : alttags) {
 				altfsas[alttag.attribute("s").as_string()] =
-				  readArchiveExtract(
-				    ar_spec->ar_path, alttag.attribute("n").as_string(), f);
+				  index.extract(alttag.attribute("n").as_string(), f);
 			}
 			auto* s = new PhonCmd(
-			  readArchiveExtract(ar_spec->ar_path, args["text2ipa"], f),
-			  altfsas, verbose, trace);
+			  index.extract(args["text2ipa"], f), altfsas, verbose, trace);
 			cmds.emplace_back(s);
 		}
 		else if ((name == u"normalise") || (name == u"normalize")) {
@@ -356,12 +712,11 @@ Pipeline Pipeline::mkPipeline(const unique_ptr<ArPipeSpec>& ar_spec,
 			auto normalisertags = cmd.children("normaliser");
 			for (const auto& normalisertag : normalisertags) {
 				normalisers[normalisertag.attribute("s").as_string()] =
-				  readArchiveExtract(ar_spec->ar_path,
-				    normalisertag.attribute("n").as_string(), f);
+				  index.extract(normalisertag.attribute("n").as_string(), f);
 			}
 			auto* s = new NormaliseCmd(
-			  readArchiveExtract(ar_spec->ar_path, args["generator"], f),
-			  readArchiveExtract(ar_spec->ar_path, args["analyser"], f),
+			  index.extract(args["generator"], f),
+			  index.extract(args["analyser"], f),
 			  normalisers, verbose);
 			cmds.emplace_back(s);
 		}
@@ -372,9 +727,8 @@ Pipeline Pipeline::mkPipeline(const unique_ptr<ArPipeSpec>& ar_spec,
 				  std::istream is(&osrb);
 				  return readTransducer(is);
 			  };
-			auto* s = new BlanktagCmd(
-			  readArchiveExtract(ar_spec->ar_path, args["blanktagger"], f),
-			  verbose);
+			auto* s =
+			  new BlanktagCmd(index.extract(args["blanktagger"], f), verbose);
 			cmds.emplace_back(s);
 		}
 		else if (name == u"suggest") {
@@ -391,9 +745,11 @@ Pipeline Pipeline::mkPipeline(const unique_ptr<ArPipeSpec>& ar_spec,
 			bool generate_all_readings =
 			  cmd.attribute("generate-all").as_bool(false);
 			auto* s = new SuggestCmd(
-			  readArchiveExtract(ar_spec->ar_path, args["generator"], procGen),
-			  readArchiveExtract(ar_spec->ar_path, args["messages"], procMsgs),
+			  index.extract(args["generator"], procGen),
+			  index.extract(args["messages"], procMsgs),
 			  locale, verbose, generate_all_readings);
+			s->setGenerationCacheSize(cmd.attribute("cache-size").as_uint(
+			  DEFAULT_GENERATION_CACHE_SIZE));
 			cmds.emplace_back(s);
 			mergePrefsFromMsgs(prefs, s->getMsgs());
 			suggestcmd = s;
@@ -401,12 +757,15 @@ Pipeline Pipeline::mkPipeline(const unique_ptr<ArPipeSpec>& ar_spec,
 		else if (name == u"sh") {
 			const auto& prog = cmd.attribute("prog").value();
 			std::vector<string> argv;
+			argv.push_back(prog);
 			for (const pugi::xml_node& arg : cmd.children()) {
 				if (strcmp(arg.name(), "arg") == 0) {
 					argv.push_back(arg.text().get());
 				}
 			}
-			cmds.emplace_back(new ShCmd(prog, argv, verbose));
+			cmds.emplace_back(new ShCmd(prog, argv,
+			  ShCmd::parseFlush(cmd.attribute("flush").value()),
+			  ShCmd::parseTimeout(cmd.attribute("timeout")), verbose));
 		}
 		else if (name == u"prefs") {
 			parsePrefs(prefs, cmd);
@@ -415,15 +774,19 @@ Pipeline Pipeline::mkPipeline(const unique_ptr<ArPipeSpec>& ar_spec,
 			throw std::runtime_error(
 			  "libdivvun: ERROR: Unknown <pipeline> element " + toUtf8(name));
 		}
+		if (stage_names.size() < cmds.size()) {
+			stage_names.push_back(stageName(cmd));
+		}
 	}
-	return Pipeline(
-	  std::move(prefs), std::move(cmds), suggestcmd, verbose, trace);
+	return Pipeline(std::make_shared<const LocalisedPrefs>(std::move(prefs)),
+	  std::move(cmds), stage_names, suggestcmd, verbose, trace);
 }
 
 Pipeline Pipeline::mkPipeline(const unique_ptr<PipeSpec>& spec,
   const u16string& pipename, bool verbose, bool trace) {
 	LocalisedPrefs prefs;
 	vector<unique_ptr<PipeCmd>> cmds;
+	vector<string> stage_names;
 	SuggestCmd* suggestcmd = nullptr;
 	if (!cg3_init(stdin, stdout, stderr)) {
 		// TODO: Move into a lib-general init function? Or can I call this safely once per CGCmd?
@@ -491,6 +854,8 @@ Pipeline Pipeline::mkPipeline(const unique_ptr<PipeSpec>& spec,
 			  cmd.attribute("generate-all").as_bool(false);
 			auto* s = new SuggestCmd(args["generator"], args["messages"],
 			  locale, verbose, generate_all_readings);
+			s->setGenerationCacheSize(cmd.attribute("cache-size").as_uint(
+			  DEFAULT_GENERATION_CACHE_SIZE));
 			cmds.emplace_back(s);
 			mergePrefsFromMsgs(prefs, s->getMsgs());
 			suggestcmd = s;
@@ -504,7 +869,9 @@ Pipeline Pipeline::mkPipeline(const unique_ptr<PipeSpec>& spec,
 					argv.push_back(arg.text().get());
 				}
 			}
-			cmds.emplace_back(new ShCmd(prog, argv, verbose));
+			cmds.emplace_back(new ShCmd(prog, argv,
+			  ShCmd::parseFlush(cmd.attribute("flush").value()),
+			  ShCmd::parseTimeout(cmd.attribute("timeout")), verbose));
 		}
 		else if (name == u"prefs") {
 			parsePrefs(prefs, cmd);
@@ -513,59 +880,532 @@ Pipeline Pipeline::mkPipeline(const unique_ptr<PipeSpec>& spec,
 			throw std::runtime_error(
 			  "libdivvun: ERROR: Unknown <pipeline> element " + toUtf8(name));
 		}
+		if (stage_names.size() < cmds.size()) {
+			stage_names.push_back(stageName(cmd));
+		}
+	}
+	return Pipeline(std::make_shared<const LocalisedPrefs>(std::move(prefs)),
+	  std::move(cmds), stage_names, suggestcmd, verbose, trace);
+}
+
+unique_ptr<Pipeline> Pipeline::clone() const {
+	vector<unique_ptr<PipeCmd>> cloned;
+	SuggestCmd* cloned_suggestcmd = nullptr;
+	for (const auto& cmd : cmds) {
+		cloned.emplace_back(cmd->clone());
+		if (cmd.get() == suggestcmd) {
+			cloned_suggestcmd = static_cast<SuggestCmd*>(cloned.back().get());
+		}
 	}
-	return Pipeline(
-	  std::move(prefs), std::move(cmds), suggestcmd, verbose, trace);
+	vector<string> stage_names;
+	for (const auto& st : stage_stats) {
+		stage_names.push_back(st.name);
+	}
+	unique_ptr<Pipeline> p(new Pipeline(shared_prefs, std::move(cloned),
+	  stage_names, cloned_suggestcmd, verbose, trace));
+	p->pipelined = pipelined;
+	p->queue_size = queue_size;
+	p->threads = threads;
+	p->chunk_size = chunk_size;
+	p->profile = profile;
+	p->tracer = tracer;
+	p->errs_cache = errs_cache;
+	p->ignores = ignores;
+	p->includes = includes;
+	p->cache_settings = cache_settings;
+	p->workers = workers;
+	p->countWorkers(true);
+	return p;
 }
 
 void Pipeline::proc(stringstream& input, stringstream& output) {
+	if (!pipelined) {
+		proc_sequential(input, output);
+		return;
+	}
+	// Every \0-separated part is its own request, outputs are joined
+	// by \0 again (like SuggestCmd does when flushing); a final \0
+	// ends the last part instead of starting an empty one:
+	const string text = input.str();
+	const bool ends_in_nul = !text.empty() && text.back() == '\0';
+	size_t beg = 0;
+	bool first = true;
+	proc_stream(
+	  [&](string& part) {
+		  if (beg > text.size() || (ends_in_nul && beg == text.size())) {
+			  return false;
+		  }
+		  size_t end = text.find('\0', beg);
+		  if (end == string::npos) {
+			  end = text.size();
+		  }
+		  part = text.substr(beg, end - beg);
+		  beg = end + 1;
+		  return true;
+	  },
+	  [&](const string& out) {
+		  if (!first) {
+			  output << '\0';
+		  }
+		  output << out;
+		  first = false;
+	  });
+	if (ends_in_nul) {
+		output << '\0';
+	}
+}
+
+void Pipeline::proc_stream(const std::function<bool(string&)>& next,
+  const std::function<void(const string&)>& done) {
+	if (!pipelined || cmds.size() < 2) {
+		for (string request; next(request);) {
+			stringstream in(request);
+			stringstream out;
+			proc_sequential(in, out);
+			done(out.str());
+		}
+		return;
+	}
+	struct Request {
+		size_t id;
+		double beg; // for tracing
+		string text;
+	};
+	// queues[i] is input to cmds[i], queues.back() is final output
+	vector<unique_ptr<BoundedQueue<Request>>> queues;
+	for (size_t i = 0; i <= cmds.size(); ++i) {
+		queues.emplace_back(new BoundedQueue<Request>(queue_size));
+	}
+	std::mutex error_mutex;
+	std::exception_ptr error = nullptr;
+	auto fail = [&](std::exception_ptr e) {
+		{
+			std::lock_guard<std::mutex> lock(error_mutex);
+			if (!error) {
+				error = e;
+			}
+		}
+		for (auto& q : queues) {
+			q->cancel();
+		}
+	};
+	vector<std::thread> workers;
+	for (size_t i = 0; i < cmds.size(); ++i) {
+		workers.emplace_back([&, i]() {
+			try {
+				for (Request request; queues[i]->pop(request);) {
+					stringstream cur_in(request.text);
+					stringstream cur_out;
+					runCmd(i, request.id, cur_in, cur_out);
+					request.text = cur_out.str();
+					if (!queues[i + 1]->push(std::move(request))) {
+						break;
+					}
+				}
+				queues[i + 1]->close();
+			}
+			catch (...) {
+				fail(std::current_exception());
+			}
+		});
+	}
+	workers.emplace_back([&]() {
+		try {
+			for (string text; next(text);) {
+				const size_t id = nextRequest();
+				const double beg = tracer ? tracer->now() : 0;
+				if (!queues.front()->push({ id, beg, std::move(text) })) {
+					break;
+				}
+			}
+			queues.front()->close();
+		}
+		catch (...) {
+			fail(std::current_exception());
+		}
+	});
+	try {
+		for (Request out; queues.back()->pop(out);) {
+			done(out.text);
+			if (tracer) {
+				tracer->span("request", "request", out.id, out.beg, tracer->now());
+			}
+		}
+	}
+	catch (...) {
+		fail(std::current_exception());
+	}
+	for (auto& w : workers) {
+		w.join();
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+}
+
+void Pipeline::proc_sequential(stringstream& input, stringstream& output) {
+	proc_stages(0, cmds.size(), input, output);
+}
+
+void Pipeline::proc_stages(
+  size_t from, size_t to, stringstream& input, stringstream& output) {
+	if (from > to || to > cmds.size()) {
+		throw std::runtime_error("libdivvun: ERROR: Pipeline has no commands " +
+		                         std::to_string(from) + " to " +
+		                         std::to_string(to));
+	}
+	const size_t request = nextRequest();
+	const double beg = tracer ? tracer->now() : 0;
+	stringstream cur(input.str());
+	runCmds(from, to, request, cur);
+	output << cur.str();
+	if (tracer) {
+		tracer->span("request", "request", request, beg, tracer->now());
+	}
+}
+
+void Pipeline::runCmds(
+  size_t from, size_t to, size_t request, stringstream& data) {
 	stringstream cur_in;
-	stringstream cur_out(input.str());
-	for (const auto& cmd : cmds) {
-		cur_in.swap(cur_out);
-		cur_out.clear();
-		cur_out.str(string());
-		cmd->run(cur_in, cur_out);
-		// if(DEBUG) { dbg("cur_out after run", cur_out); }
+	for (size_t i = from; i < to; ++i) {
+		cur_in.swap(data);
+		data.clear();
+		data.str(string());
+		runCmd(i, request, cur_in, data);
+		// if(DEBUG) { dbg("data after run", data); }
+	}
+}
+
+size_t Pipeline::nextRequest() {
+	return tracer ? tracer->nextRequest() : 0;
+}
+
+double threadCpuSecs() {
+	struct timespec ts;
+	if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) {
+		return 0;
 	}
-	output << cur_out.str();
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Count a cohort ("<wf>") or reading (\t"lemma" …) line of CG stream
+// format; subreadings and traced-away readings aren't counted
+void countCohortLine(
+  const char* line, size_t len, size_t& cohorts, size_t& readings) {
+	if (len > 1) {
+		if (line[0] == '"' && line[1] == '<') {
+			++cohorts;
+		}
+		else if (line[0] == '\t' && line[1] == '"') {
+			++readings;
+		}
+	}
+}
+
+// Add size, cohorts and readings of a stream to the counters
+void countStream(const stringstream& stream, size_t& bytes, size_t& cohorts,
+  size_t& readings) {
+	const string text = stream.str();
+	bytes += text.size();
+	for (size_t beg = 0; beg < text.size();) {
+		size_t end = text.find('\n', beg);
+		if (end == string::npos) {
+			end = text.size();
+		}
+		countCohortLine(text.data() + beg, end - beg, cohorts, readings);
+		beg = end + 1;
+	}
+}
+
+// Adds one call, timed from construction until done, to StageStats
+class StageTimer {
+public:
+	StageTimer()
+	  : wall_beg(std::chrono::steady_clock::now())
+	  , cpu_beg(threadCpuSecs()) {}
+	void done(StageStats& st) const {
+		const double cpu = threadCpuSecs() - cpu_beg;
+		const double wall = std::chrono::duration<double>(
+		  std::chrono::steady_clock::now() - wall_beg).count();
+		++st.calls;
+		st.wall_secs += wall;
+		st.max_wall_secs = std::max(st.max_wall_secs, wall);
+		st.cpu_secs += cpu;
+	}
+
+private:
+	const std::chrono::steady_clock::time_point wall_beg;
+	const double cpu_beg;
+};
+
+void Pipeline::runCmd(
+  size_t i, size_t request, stringstream& input, stringstream& output) {
+	if (!profile && !tracer) {
+		cmds[i]->run(input, output);
+		return;
+	}
+	StageStats& st = stage_stats[i];
+	if (profile) {
+		countStream(input, st.bytes_in, st.cohorts_in, st.readings_in);
+	}
+	const double beg = tracer ? tracer->now() : 0;
+	const StageTimer timer;
+	cmds[i]->run(input, output);
+	if (tracer) {
+		tracer->span(st.name, "stage", request, beg, tracer->now());
+	}
+	if (profile) {
+		timer.done(st);
+		countStream(output, st.bytes_out, st.cohorts_out, st.readings_out);
+	}
+}
+
+// Approximate memory used by a cached proc_errs result
+size_t errsCacheSize(const string& key, const vector<Err>& errs) {
+	size_t size = 64 + key.size() + errs.capacity() * sizeof(Err);
+	for (const auto& e : errs) {
+		size += 2 * (e.form.size() + e.err.size() + e.msg.first.size() +
+		             e.msg.second.size());
+		for (const auto& r : e.rep) {
+			size += sizeof(r) + 2 * r.size();
+		}
+	}
+	return size;
 }
 
 vector<Err> Pipeline::proc_errs(stringstream& input) {
+	if (chunk_size != 0 && input.str().size() > chunk_size) {
+		// (bytes are at least as many as UTF-16 units)
+		const u16string text = fromUtf8(input.str());
+		if (text.size() > chunk_size) {
+			return proc_errs_chunked(text);
+		}
+	}
+	return proc_errs_cached(input);
+}
+
+vector<Err> Pipeline::proc_errs_chunked(const u16string& text) {
+	vector<string> chunks;
+	vector<size_t> offsets;
+	size_t beg = 0;
+	size_t len = 0;
+	for (const auto sentence : splitSentences(text)) {
+		if (len > 0 && len + sentence > chunk_size) {
+			chunks.push_back(toUtf8(text.substr(beg, len)));
+			offsets.push_back(beg);
+			beg += len;
+			len = 0;
+		}
+		len += sentence;
+	}
+	if (len > 0) {
+		chunks.push_back(toUtf8(text.substr(beg, len)));
+		offsets.push_back(beg);
+	}
+	vector<Err> errs;
+	const auto results = proc_errs_batch(chunks);
+	for (size_t i = 0; i < results.size(); ++i) {
+		for (auto e : results[i]) {
+			e.beg += offsets[i];
+			e.end += offsets[i];
+			errs.push_back(std::move(e));
+		}
+	}
+	return errs;
+}
+
+vector<Err> Pipeline::proc_errs_cached(stringstream& input) {
+	if (!errs_cache) {
+		return proc_errs_uncached(input);
+	}
+	const string key = cache_settings + input.str();
+	vector<Err> errs;
+	if (errs_cache->get(key, errs)) {
+		return errs;
+	}
+	errs = proc_errs_uncached(input);
+	errs_cache->put(key, errs);
+	return errs;
+}
+
+vector<Err> Pipeline::proc_errs_uncached(stringstream& input) {
 	if (suggestcmd == nullptr || cmds.empty() ||
 	    suggestcmd != cmds.back().get()) {
 		throw std::runtime_error("Can't create cohorts without a SuggestCmd "
 		                         "as the final Pipeline command!");
 	}
-	stringstream cur_in;
-	stringstream cur_out(input.str());
+	const size_t request = nextRequest();
+	const double req_beg = tracer ? tracer->now() : 0;
+	stringstream cur_in(input.str());
 	size_t i_last = cmds.size() - 1;
-	for (size_t i = 0; i < i_last; ++i) {
-		const auto& cmd = cmds[i];
-		cur_in.swap(cur_out);
-		cur_out.clear();
-		cur_out.str(string());
-		cmd->run(cur_in, cur_out);
+	runCmds(0, i_last, request, cur_in);
+	if (!profile && !tracer) {
+		return suggestcmd->run_errs(cur_in);
+	}
+	StageStats& st = stage_stats[i_last];
+	if (profile) {
+		countStream(cur_in, st.bytes_in, st.cohorts_in, st.readings_in);
+	}
+	const double beg = tracer ? tracer->now() : 0;
+	const StageTimer timer;
+	auto errs = suggestcmd->run_errs(cur_in);
+	if (tracer) {
+		const double end = tracer->now();
+		tracer->span(st.name, "stage", request, beg, end);
+		tracer->span("request", "request", request, req_beg, end);
+	}
+	if (profile) {
+		timer.done(st);
+	}
+	return errs;
+}
+
+vector<vector<Err>> Pipeline::proc_errs_batch(const vector<string>& texts) {
+	vector<vector<Err>> results(texts.size());
+	size_t n = threads == 0 ? std::thread::hardware_concurrency() : threads;
+	n = std::max<size_t>(1, std::min(n, texts.size()));
+	while (batch_workers.size() + 1 < n) {
+		batch_workers.emplace_back(clone());
+	}
+	std::atomic<size_t> next(0);
+	std::mutex error_mutex;
+	std::exception_ptr error = nullptr;
+	auto work = [&](Pipeline& pipeline) {
+		try {
+			for (size_t i = next++; i < texts.size(); i = next++) {
+				stringstream input(texts[i]);
+				results[i] = pipeline.proc_errs_cached(input);
+			}
+		}
+		catch (...) {
+			std::lock_guard<std::mutex> lock(error_mutex);
+			if (!error) {
+				error = std::current_exception();
+			}
+			next = texts.size(); // stop the others
+		}
+	};
+	vector<std::thread> pool;
+	for (size_t w = 1; w < n; ++w) {
+		pool.emplace_back(work, std::ref(*batch_workers[w - 1]));
+	}
+	work(*this);
+	for (auto& t : pool) {
+		t.join();
+	}
+	if (error) {
+		std::rethrow_exception(error);
+	}
+	return results;
+}
+
+void Pipeline::setThreads(size_t threads_) {
+	threads = threads_;
+}
+
+void Pipeline::setChunkSize(size_t units) {
+	chunk_size = units;
+}
+
+void Pipeline::setPipelined(bool pipelined_) {
+	pipelined = pipelined_;
+}
+
+void Pipeline::setProfile(bool profile_) {
+	profile = profile_;
+	for (auto& w : batch_workers) {
+		w->setProfile(profile);
 	}
-	cur_in.swap(cur_out);
-	return suggestcmd->run_errs(cur_in);
 }
-void Pipeline::setIgnores(const std::set<ErrId>& ignores) {
+
+vector<StageStats> Pipeline::stats() const {
+	vector<StageStats> sum = stage_stats;
+	for (const auto& w : batch_workers) {
+		for (size_t i = 0; i < sum.size(); ++i) {
+			addStageStats(sum[i], w->stage_stats[i]);
+		}
+	}
+	return sum;
+}
+
+void Pipeline::setTraceOut(const string& path) {
+	tracer = path.empty() ? nullptr : std::make_shared<TraceWriter>(path);
+	for (auto& w : batch_workers) {
+		w->tracer = tracer;
+	}
+}
+
+void Pipeline::resetStats() {
+	for (auto& st : stage_stats) {
+		st = StageStats { st.name };
+	}
+	for (auto& w : batch_workers) {
+		w->resetStats();
+	}
+}
+
+void Pipeline::setCacheSize(size_t max_bytes) {
+	if (max_bytes == 0) {
+		errs_cache = nullptr;
+	}
+	else if (errs_cache) {
+		errs_cache->setMaxSize(max_bytes);
+	}
+	else {
+		errs_cache = std::make_shared<LruCache<string, vector<Err>>>(
+		  max_bytes, errsCacheSize);
+	}
+	for (auto& w : batch_workers) {
+		w->errs_cache = errs_cache;
+	}
+}
+
+CacheStats Pipeline::cacheStats() const {
+	return errs_cache ? errs_cache->stats() : CacheStats();
+}
+
+CacheStats Pipeline::generationCacheStats() const {
+	return suggestcmd ? suggestcmd->generationCacheStats() : CacheStats();
+}
+
+// Results for other ignores/includes are kept, under other keys
+void Pipeline::updateCacheSettings() {
+	cache_settings.clear();
+	for (const auto& id : ignores) {
+		cache_settings += "-" + toUtf8(id) + "\n";
+	}
+	for (const auto& id : includes) {
+		cache_settings += "+" + toUtf8(id) + "\n";
+	}
+	cache_settings += '\0';
+}
+
+void Pipeline::setIgnores(const std::set<ErrId>& ignores_) {
 	if (suggestcmd != nullptr) {
-		suggestcmd->setIgnores(ignores);
+		suggestcmd->setIgnores(ignores_);
+		ignores = ignores_;
+		updateCacheSettings();
+		for (auto& w : batch_workers) {
+			w->setIgnores(ignores_);
+		}
 	}
-	else if (!ignores.empty()) {
+	else if (!ignores_.empty()) {
 		throw std::runtime_error("libdivvun: ERROR: Can't set ignores "
 		                         "when last command of pipeline is not "
 		                         "a SuggestCmd");
 	}
 }
 
-void Pipeline::setIncludes(const std::set<ErrId>& includes) {
+void Pipeline::setIncludes(const std::set<ErrId>& includes_) {
 	if (suggestcmd != nullptr) {
-		suggestcmd->setIncludes(includes);
+		suggestcmd->setIncludes(includes_);
+		includes = includes_;
+		updateCacheSettings();
+		for (auto& w : batch_workers) {
+			w->setIncludes(includes_);
+		}
 	}
-	else if (!includes.empty()) {
+	else if (!includes_.empty()) {
 		throw std::runtime_error("libdivvun: ERROR: Can't set includes "
 		                         "when last command of pipeline is not "
 		                         "a SuggestCmd");
@@ -22,8 +22,12 @@
 #		include <config.h>
 #	endif
 
+#	include <algorithm>
 #	include <cstring>
 #	include <cerrno>
+#	include <functional>
+#	include <memory>
+#	include <mutex>
 
 // divvun-gramcheck:
 #	include "pipespec.hpp"
@@ -32,8 +36,11 @@
 #		include "cgspell.hpp"
 #	endif
 #	include "blanktag.hpp"
+#	include "lrucache.hpp"
 #	include "normaliser.hpp"
 #	include "phon.hpp"
+#	include "tracing.hpp"
+#	include "workqueue.hpp"
 // xml:
 #	include <pugixml.hpp>
 // cg3:
@@ -83,6 +90,20 @@ typedef int64_t la_int64_t;
 #	endif // HAVE_LIBARCHIVE
 
 
+// Add the counters of st to sum (of the same command in another clone)
+inline void addStageStats(StageStats& sum, const StageStats& st) {
+	sum.calls += st.calls;
+	sum.wall_secs += st.wall_secs;
+	sum.max_wall_secs = std::max(sum.max_wall_secs, st.max_wall_secs);
+	sum.cpu_secs += st.cpu_secs;
+	sum.bytes_in += st.bytes_in;
+	sum.bytes_out += st.bytes_out;
+	sum.cohorts_in += st.cohorts_in;
+	sum.readings_in += st.readings_in;
+	sum.cohorts_out += st.cohorts_out;
+	sum.readings_out += st.readings_out;
+}
+
 // https://stackoverflow.com/a/1449527/69663
 struct OneShotReadBuf : public std::streambuf {
 	OneShotReadBuf(char* s, size_t n) { setg(s, s, s + n); }
@@ -92,6 +113,13 @@ class PipeCmd {
 public:
 	PipeCmd() = default;
 	virtual void run(stringstream& input, stringstream& output) const = 0;
+	// A new command sharing the loaded (read-only) data of this one, but
+	// with its own state, so the two may run in different threads
+	virtual unique_ptr<PipeCmd> clone() const = 0;
+	// At most how many threads will run this command and its clones at
+	// once; commands that copy shared models when runs overlap make no
+	// more copies than that
+	virtual void setWorkers(size_t workers) {}
 	virtual ~PipeCmd() = default;
 	// no copying
 	PipeCmd(PipeCmd const&) = delete;
@@ -103,16 +131,19 @@ class TokenizeCmd : public PipeCmd {
 public:
 	TokenizeCmd(std::istream& instream, int weight_classes, bool verbose);
 	TokenizeCmd(const string& path, int weight_classes, bool verbose);
+	TokenizeCmd(SharedBytes bytes, int weight_classes, bool verbose);
 	void run(stringstream& input, stringstream& output) const override;
+	unique_ptr<PipeCmd> clone() const override;
+	void setWorkers(size_t workers) override;
 	~TokenizeCmd() override = default;
 
 private:
-	hfst_ol::PmatchContainer* mkContainer(
-	  std::istream& instream, int weight_classes, bool verbose);
+	TokenizeCmd(const TokenizeCmd& other);
 	hfst_ol_tokenize::TokenizeSettings settings;
-	unique_ptr<std::istream>
-	  istream; // Only used if we're not given a stream in the first place
-	unique_ptr<hfst_ol::PmatchContainer> container;
+	// A container holds both the transducers and the tokenisation
+	// state, so runs overlapping in several threads (of clones) each
+	// need their own; more are read from bytes when that happens:
+	std::shared_ptr<Pool<hfst_ol::PmatchContainer>> containers;
 };
 
 
@@ -128,6 +159,9 @@ struct CGMweSplitApplicatorDeleter {
 
 struct CGGrammarDeleter {
 	void operator()(cg3_grammar* ptr) {
+		if (ptr == nullptr) { // shared_ptr calls us even when empty
+			return;
+		}
 		cg3_grammar_free(ptr);
 		if (!cg3_cleanup()) {
 			std::cerr << "libdivvun: WARNING: Couldn't cleanup from CG3"
@@ -141,6 +175,7 @@ public:
 	/* Assumes cg3_init has been called already */
 	explicit MweSplitCmd(bool verbose);
 	void run(stringstream& input, stringstream& output) const override;
+	unique_ptr<PipeCmd> clone() const override;
 	~MweSplitCmd() override = default;
 
 private:
@@ -160,9 +195,12 @@ public:
 	  const map<string, const hfst::HfstTransducer*>& normalisers,
 	  bool verbose);
 	void run(stringstream& input, stringstream& output) const override;
+	unique_ptr<PipeCmd> clone() const override;
+	void setWorkers(size_t workers) override;
 	~NormaliseCmd() override = default;
 
 private:
+	explicit NormaliseCmd(Normaliser* normaliser);
 	unique_ptr<Normaliser> normaliser;
 };
 
@@ -172,12 +210,16 @@ public:
 	CGCmd(const char* buff, const size_t size, bool verbose, bool trace);
 	CGCmd(const string& path, bool verbose, bool trace);
 	void run(stringstream& input, stringstream& output) const override;
+	unique_ptr<PipeCmd> clone() const override;
 	~CGCmd() override = default;
 
 private:
-	unique_ptr<cg3_grammar, CGGrammarDeleter> grammar;
+	// The grammar is only read by applicators, so clones share it
+	CGCmd(std::shared_ptr<cg3_grammar> grammar, bool trace);
+	std::shared_ptr<cg3_grammar> grammar;
 	// cg3_grammar* grammar;
 	unique_ptr<cg3_applicator, CGApplicatorDeleter> applicator;
+	bool trace;
 	// cg3_applicator* applicator;
 };
 
@@ -190,6 +232,7 @@ public:
 	CGSpellCmd(const string& err_path, const string& lex_path, int limit,
 	  float beam, float max_weight, float max_sent_unknown_rate, bool verbose);
 	void run(stringstream& input, stringstream& output) const override;
+	unique_ptr<PipeCmd> clone() const override;
 	~CGSpellCmd() override = default;
 	// Some sane defaults for the speller
 	// TODO: Do we want any of this configurable from pipespec.xml, or from the Checker API?
@@ -198,6 +241,7 @@ public:
 	static constexpr float time_cutoff = 0.0;
 
 private:
+	explicit CGSpellCmd(Speller* speller);
 	unique_ptr<Speller> speller;
 };
 #	endif
@@ -207,9 +251,12 @@ public:
 	BlanktagCmd(const hfst::HfstTransducer* analyser, bool verbose);
 	BlanktagCmd(const string& ana_path, bool verbose);
 	void run(stringstream& input, stringstream& output) const override;
+	unique_ptr<PipeCmd> clone() const override;
+	void setWorkers(size_t workers) override;
 	~BlanktagCmd() override = default;
 
 private:
+	explicit BlanktagCmd(Blanktag* blanktag);
 	unique_ptr<Blanktag> blanktag;
 };
 
@@ -221,9 +268,12 @@ public:
 	PhonCmd(const string& ana_path, const map<string, string>& alttagpaths,
 	  bool verbose, bool trace);
 	void run(stringstream& input, stringstream& output) const override;
+	unique_ptr<PipeCmd> clone() const override;
+	void setWorkers(size_t workers) override;
 	~PhonCmd() override = default;
 
 private:
+	explicit PhonCmd(Phon* phon);
 	unique_ptr<Phon> phon;
 };
 
@@ -236,23 +286,68 @@ public:
 	  const string& locale, bool verbose, bool generate_all_readings);
 	void run(stringstream& input, stringstream& output) const override;
 	vector<Err> run_errs(stringstream& input) const;
+	unique_ptr<PipeCmd> clone() const override;
+	void setWorkers(size_t workers) override;
 	~SuggestCmd() override = default;
 	void setIgnores(const std::set<ErrId>& ignores);
 	void setIncludes(const std::set<ErrId>& includes);
 	const MsgMap& getMsgs();
+	void setGenerationCacheSize(size_t max_bytes);
+	CacheStats generationCacheStats() const;
 
 private:
+	explicit SuggestCmd(Suggest* suggest);
 	unique_ptr<Suggest> suggest;
 };
 
+// Write without a SIGPIPE if the reader has gone away (only EPIPE),
+// leaving the process-wide disposition alone; on macOS, fd needs
+// F_SETNOSIGPIPE set
+ssize_t writeNoSigpipe(int fd, const char* buf, size_t n);
+
+/**
+ * Runs an external program, started on the first run and kept
+ * running for the next ones. Each request is written to its stdin
+ * followed by a flush (a \0 byte, or a <STREAMCMD:FLUSH> line), and
+ * its stdout is read until it echoes that flush, so the program must
+ * output one flush for each it reads.
+ */
 class ShCmd : public PipeCmd {
 public:
-	ShCmd(const string& prog, const std::vector<string>& args, bool verbose);
+	enum Flush { FlushNul, FlushStreamCmd };
+	// args[0] is the program name as the program sees it; a request
+	// fails if the program is silent for timeout_ms (0 to wait forever)
+	ShCmd(const string& prog, const std::vector<string>& args, Flush flush,
+	  int timeout_ms, bool verbose);
 	void run(stringstream& input, stringstream& output) const override;
+	unique_ptr<PipeCmd> clone() const override;
 	~ShCmd() override;
 
+	// From the flush attribute of <sh>, "nul" (default) or "streamcmd"
+	static Flush parseFlush(const string& flush);
+	// From the timeout attribute of <sh>, in seconds (default 60)
+	static int parseTimeout(const pugi::xml_attribute& timeout);
+
 private:
+	const string prog;
+	const std::vector<string> args;
+	const Flush flush;
+	const int timeout_ms;
+	const bool verbose;
 	char** argv;
+	// The running program, if started:
+	mutable pid_t pid = -1;
+	mutable int to_prog = -1;
+	mutable int from_prog = -1;
+	// Output read past the last flush
+	mutable string pending;
+	void start() const;
+	// Close its input and wait for it to exit, killing it if it
+	// doesn't do so soon (or right away if kill)
+	void stop(bool kill = false) const;
+	// Start of the n'th flush in out, or string::npos
+	size_t findFlush(const string& out, size_t n) const;
+	size_t flushSize() const;
 };
 
 inline void parsePrefs(LocalisedPrefs& prefs, const pugi::xml_node& cmd) {
@@ -312,6 +407,8 @@ public:
 	  bool verbose, bool trace = false);
 	Pipeline(const unique_ptr<ArPipeSpec>& spec, const u16string& pipename,
 	  bool verbose, bool trace = false);
+	Pipeline(Pipeline&& other) = default;
+	~Pipeline();
 	// ~Pipeline() {
 	// TODO: gives /usr/include/c++/6/bits/stl_construct.h:75:7: error: use of deleted function ‘unique_ptr<_Tp, _Dp>::unique_ptr(const unique_ptr<_Tp, _Dp>&) [with _Tp = divvun::PipeCmd; _Dp = std::default_delete<divvun::PipeCmd>]’
 	// 	if (!cg3_cleanup()) {
@@ -323,19 +420,115 @@ public:
 	// Run pipeline on input, printing to output
 	void proc(stringstream& input, stringstream& output);
 
+	// Run pipeline on each request given by next (until it returns
+	// false), handing the output of each to done, in input order.
+	// In pipelined mode, every command runs in its own thread, so
+	// command i can work on one request while command i+1 works on
+	// the previous one; next is then called from a separate thread.
+	void proc_stream(const std::function<bool(string&)>& next,
+	  const std::function<void(const string&)>& done);
+
+	// Run only commands from up to (not including) to on input,
+	// e.g. to time one stage on its recorded input; stats() has
+	// the names of the commands
+	void proc_stages(
+	  size_t from, size_t to, stringstream& input, stringstream& output);
+
 	// Run pipeline that ends in a SuggestCmd on input,
 	// and instead of printing output with SuggestCmd.run,
 	// we use SuggestCmd.run_errs as the last step
 	vector<Err> proc_errs(stringstream& input);
 
+	// Run proc_errs on each of texts, spread over several threads
+	// (see setThreads); results are in the same order as texts.
+	// Texts are not split into chunks here, see setChunkSize.
+	vector<vector<Err>> proc_errs_batch(const vector<string>& texts);
+	// How many threads proc_errs_batch may use; 0 means one per CPU
+	void setThreads(size_t threads);
+	// If not 0, proc_errs splits texts longer than this many UTF-16
+	// units into chunks of whole sentences (see splitSentences) of
+	// about this size, and checks them in parallel like
+	// proc_errs_batch
+	void setChunkSize(size_t units);
+
+	// A new Pipeline sharing all loaded data (transducers, grammars,
+	// messages, preferences) with this one, but with its own
+	// applicators, caches and settings; the two may be used in
+	// different threads at the same time.
+	unique_ptr<Pipeline> clone() const;
+
 	const bool verbose;
 	const bool trace;
 	// Preferences:
 	void setIgnores(const std::set<ErrId>& ignores);
 	void setIncludes(const std::set<ErrId>& includes);
-	const LocalisedPrefs prefs;
+private:
+	std::set<ErrId> ignores;
+	std::set<ErrId> includes;
+	std::shared_ptr<const LocalisedPrefs> shared_prefs;
+public:
+	const LocalisedPrefs& prefs;
+	// If true, proc splits input on \0 and sends the parts through
+	// the commands concurrently (see proc_stream). Output is the same
+	// as when running sequentially.
+	void setPipelined(bool pipelined);
+	// How many requests may wait between two commands in pipelined mode
+	size_t queue_size = 16;
+	// If true, every command run is timed and counted, see stats
+	void setProfile(bool profile);
+	// Profiling counters per command, in pipeline order, including
+	// those of proc_errs_batch threads; don't call while processing
+	vector<StageStats> stats() const;
+	void resetStats();
+	// Write a span per request and per command run to path, in the
+	// Chrome trace event format; empty path turns it off. The
+	// default is to trace to $DIVVUN_TRACE_OUT if that is set.
+	void setTraceOut(const string& path);
+	// Keep the results of proc_errs for up to about max_bytes of
+	// texts and errors, so unchanged paragraphs aren't checked again;
+	// 0 (the default) turns the cache off. The cache is shared with
+	// clones; it is keyed on the text and the ignores/includes.
+	void setCacheSize(size_t max_bytes);
+	CacheStats cacheStats() const;
+	// Lookups in the <suggest> generator cache (whose size is set by
+	// its cache-size attribute in the pipespec)
+	CacheStats generationCacheStats() const;
 
 private:
+	bool pipelined = false;
+	size_t threads = 0;
+	bool profile = false;
+	// stage_stats[i] is for cmds[i], only updated when profile is set
+	vector<StageStats> stage_stats;
+	// Shared with clones, nullptr unless tracing
+	std::shared_ptr<TraceWriter> tracer;
+	// Shared with clones, nullptr unless caching
+	std::shared_ptr<LruCache<string, vector<Err>>> errs_cache;
+	// Ignores and includes, as the start of errs_cache keys
+	string cache_settings = string(1, '\0');
+	void updateCacheSettings();
+	vector<Err> proc_errs_cached(stringstream& input);
+	vector<Err> proc_errs_uncached(stringstream& input);
+	size_t chunk_size = 0;
+	vector<Err> proc_errs_chunked(const u16string& text);
+	void runCmd(size_t i, size_t request, stringstream& input,
+	  stringstream& output);
+	// Run commands from up to to on data, leaving their output there
+	void runCmds(size_t from, size_t to, size_t request, stringstream& data);
+	// Clones used by the other proc_errs_batch threads (the first
+	// thread uses this Pipeline), kept for the next batch:
+	vector<unique_ptr<Pipeline>> batch_workers;
+	// How many Pipelines (this, its clones and theirs) there are,
+	// shared between them; the commands are told (setWorkers),
+	// since that many threads may run them at once
+	struct Workers {
+		std::mutex mutex;
+		size_t count = 1;
+	};
+	std::shared_ptr<Workers> workers;
+	void countWorkers(bool added);
+	void proc_sequential(stringstream& input, stringstream& output);
+	size_t nextRequest();
 	vector<unique_ptr<PipeCmd>> cmds;
 	// the final command, if it is SuggestCmd, can also do non-stringly-typed output, see proc_errs
 	SuggestCmd* suggestcmd;
@@ -344,7 +537,8 @@ private:
 	  const u16string& pipename, bool verbose, bool trace);
 	static Pipeline mkPipeline(const unique_ptr<ArPipeSpec>& spec,
 	  const u16string& pipename, bool verbose, bool trace);
-	Pipeline(LocalisedPrefs prefs, vector<unique_ptr<PipeCmd>> cmds,
+	Pipeline(std::shared_ptr<const LocalisedPrefs> prefs,
+	  vector<unique_ptr<PipeCmd>> cmds, const vector<string>& stage_names,
 	  SuggestCmd* suggestcmd, bool verbose, bool trace);
 };
 
@@ -38,8 +38,14 @@
 #include <sstream>
 #include <fstream>
 #include <regex>
+#include <set>
 #include <vector>
 #include <sys/stat.h>
+#ifdef HAVE_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif	// HAVE_MMAP
 
 // divvun-gramcheck:
 #include "util.hpp"
@@ -97,7 +103,154 @@ using ArEntryHandler = std::function<Ret(const string& ar_path, const void* buff
 
 const size_t AR_BLOCK_SIZE = 10240;
 
+/**
+ * Bytes that stay valid for as long as data is held, whether they are
+ * a copy of their own or point into something bigger (like a mapped
+ * archive) that data keeps alive.
+ */
+struct SharedBytes {
+	std::shared_ptr<const char> data;
+	size_t size;
+};
+
+inline SharedBytes copyBytes(string bytes)
+{
+	const auto owner = std::make_shared<const string>(std::move(bytes));
+	return { std::shared_ptr<const char>(owner, owner->data()), owner->size() };
+}
+
+/**
+ * A read-only mapping of a whole file; data is nullptr if the file
+ * couldn't be mapped.
+ */
+class MappedFile {
+	public:
+		explicit MappedFile(const string& path)
+		{
+#ifdef HAVE_MMAP
+			int fd = open(path.c_str(), O_RDONLY);
+			if (fd < 0) {
+				return;
+			}
+			struct stat st;
+			if (fstat(fd, &st) == 0 && st.st_size > 0) {
+				void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+				if (p != MAP_FAILED) {
+					data = (const char*)p;
+					size = st.st_size;
+				}
+			}
+			::close(fd);
+#endif	// HAVE_MMAP
+		}
+		~MappedFile()
+		{
+#ifdef HAVE_MMAP
+			if (data != nullptr) {
+				munmap((void*)data, size);
+			}
+#endif	// HAVE_MMAP
+		}
+		MappedFile(MappedFile const &) = delete;
+		MappedFile &operator=(MappedFile const &) = delete;
+		const char* data = nullptr;
+		size_t size = 0;
+};
+
+/**
+ * Find the entries of a zip file that are stored without compression
+ * (zip -0), returning where their data is in the file. Anything we
+ * don't understand (zip64, encryption, not a zip) is left out, and
+ * has to be read with libarchive instead.
+ */
+inline std::unordered_map<string, std::pair<size_t, size_t>> storedZipEntries(const char* zip, const size_t size)
+{
+	std::unordered_map<string, std::pair<size_t, size_t>> stored;
+	const auto u16 = [&](size_t pos) -> size_t {
+		return (unsigned char)zip[pos] | ((unsigned char)zip[pos + 1] << 8);
+	};
+	const auto u32 = [&](size_t pos) -> size_t {
+		return u16(pos) | (u16(pos + 2) << 16);
+	};
+	// End of central directory record, possibly followed by a comment:
+	const size_t EOCD_SIZE = 22;
+	if (size < EOCD_SIZE) {
+		return stored;
+	}
+	size_t eocd = size - EOCD_SIZE;
+	const size_t eocd_min = size > EOCD_SIZE + 0xFFFF ? size - EOCD_SIZE - 0xFFFF : 0;
+	while (u32(eocd) != 0x06054b50) {
+		if (eocd == eocd_min) {
+			return stored;
+		}
+		--eocd;
+	}
+	const size_t n_entries = u16(eocd + 10);
+	size_t pos = u32(eocd + 16);
+	for (size_t i = 0; i < n_entries; ++i) {
+		const size_t CDH_SIZE = 46;
+		if (pos + CDH_SIZE > size || u32(pos) != 0x02014b50) {
+			break;
+		}
+		const size_t flags = u16(pos + 8);
+		const size_t method = u16(pos + 10);
+		const size_t csize = u32(pos + 20);
+		const size_t usize = u32(pos + 24);
+		const size_t name_len = u16(pos + 28);
+		const size_t next = pos + CDH_SIZE + name_len + u16(pos + 30) + u16(pos + 32);
+		const size_t local = u32(pos + 42);
+		if (next > size) {
+			break;
+		}
+		const string name(zip + pos + CDH_SIZE, name_len);
+		const size_t LFH_SIZE = 30;
+		if (method == 0 && (flags & 1) == 0 && csize == usize && csize != 0xFFFFFFFF
+		    && local + LFH_SIZE <= size && u32(local) == 0x04034b50
+		    && stored.count(name) == 0) {
+			const size_t data = local + LFH_SIZE + u16(local + 26) + u16(local + 28);
+			if (data + csize <= size) {
+				stored[name] = std::make_pair(data, csize);
+			}
+		}
+		pos = next;
+	}
+	return stored;
+}
+
 #ifdef HAVE_LIBARCHIVE
+/* Read the data of the entry we're at (after archive_read_next_header) */
+inline string archiveEntryData(archive *ar, struct archive_entry* entry, const string& filename)
+{
+	size_t fullsize = 0;
+	const struct stat* st = archive_entry_stat(entry);
+	size_t buffsize = st->st_size;
+	if (buffsize == 0) {
+		std::cerr << archive_error_string(ar) << std::endl;
+		throw std::runtime_error("libdivvun: ERROR: Got a zero length archive entry for " + filename);
+	}
+	string buff(buffsize, 0);
+	for (;;) {
+		ssize_t curr = archive_read_data(ar, &buff[0] + fullsize, buffsize - fullsize);
+		if (0 == curr) {
+			break;
+		}
+		else if (ARCHIVE_RETRY == curr) {
+			continue;
+		}
+		else if (ARCHIVE_FAILED == curr) {
+			throw std::runtime_error("libdivvun: ERROR: Archive broken (ARCHIVE_FAILED)");
+		}
+		else if (curr < 0) {
+			throw std::runtime_error("libdivvun: ERROR: Archive broken " + std::to_string(curr));
+		}
+		else {
+			fullsize += curr;
+		}
+	}
+	buff.resize(fullsize);
+	return buff;
+}
+
 template<typename Ret>
 Ret archiveExtract(const string& ar_path,
 		   archive *ar,
@@ -115,42 +268,14 @@ Ret archiveExtract(const string& ar_path,
 		}
 		string filename(archive_entry_pathname(entry));
 		if (filename == entry_pathname) {
-			size_t fullsize = 0;
-			const struct stat* st = archive_entry_stat(entry);
-			size_t buffsize = st->st_size;
-			if (buffsize == 0) {
-				std::cerr << archive_error_string(ar) << std::endl;
-				throw std::runtime_error("libdivvun: ERROR: Got a zero length archive entry for " + filename);
-			}
-			string buff(buffsize, 0);
-			for (;;) {
-				ssize_t curr = archive_read_data(ar, &buff[0] + fullsize, buffsize - fullsize);
-				if (0 == curr) {
-					break;
-				}
-				else if (ARCHIVE_RETRY == curr) {
-					continue;
-				}
-				else if (ARCHIVE_FAILED == curr) {
-					throw std::runtime_error("libdivvun: ERROR: Archive broken (ARCHIVE_FAILED)");
-				}
-				else if (curr < 0) {
-					throw std::runtime_error("libdivvun: ERROR: Archive broken " + std::to_string(curr));
-				}
-				else {
-					fullsize += curr;
-				}
-			}
-			return procFile(ar_path, buff.c_str(), fullsize);
+			const string buff = archiveEntryData(ar, entry, filename);
+			return procFile(ar_path, buff.c_str(), buff.size());
 		}
 	} // while r != ARCHIVE_EOF
 	throw std::runtime_error("libdivvun: ERROR: Couldn't find " + entry_pathname + " in archive");
 }
 
-template<typename Ret>
-Ret readArchiveExtract(const string& ar_path,
-		       const string& entry_pathname,
-		       ArEntryHandler<Ret>procFile)
+inline archive* openArchive(const string& ar_path)
 {
 	struct archive* ar = archive_read_new();
 #if USE_LIBARCHIVE_2
@@ -168,16 +293,123 @@ Ret readArchiveExtract(const string& ar_path,
 		std::cerr << msg.str(); // TODO: why does the below cut off the string?
 		throw std::runtime_error(msg.str());
 	}
-	Ret ret = archiveExtract(ar_path, ar, entry_pathname, procFile);
+	return ar;
+}
 
+inline void closeArchive(archive* ar)
+{
 #if USE_LIBARCHIVE_2
 	archive_read_close(ar);
 	archive_read_finish(ar);
 #else
 	archive_read_free(ar);
 #endif // USE_LIBARCHIVE_2
+}
+
+template<typename Ret>
+Ret readArchiveExtract(const string& ar_path,
+		       const string& entry_pathname,
+		       ArEntryHandler<Ret>procFile)
+{
+	struct archive* ar = openArchive(ar_path);
+	Ret ret = archiveExtract(ar_path, ar, entry_pathname, procFile);
+	closeArchive(ar);
 	return ret;
 }
+
+/**
+ * The data of a set of archive entries, read in a single pass over
+ * the archive, instead of reopening and scanning the archive once per
+ * entry like readArchiveExtract.
+ *
+ * Entries stored uncompressed in a zip (zip -0) are not read at all,
+ * but handed out directly from a read-only mapping of the archive,
+ * which lives as long as the ArIndex, or longer for data taken with
+ * shared().
+ */
+class ArIndex {
+	public:
+		ArIndex(const string& ar_path_, const std::set<string>& entry_pathnames)
+			: ar_path(ar_path_)
+			, mapped(std::make_shared<const MappedFile>(ar_path_))
+		{
+			if (mapped->data != nullptr) {
+				for (const auto& st : storedZipEntries(mapped->data, mapped->size)) {
+					if (entry_pathnames.count(st.first) != 0) {
+						stored[st.first] = st.second;
+					}
+				}
+			}
+			if (stored.size() == entry_pathnames.size()) {
+				return;
+			}
+			struct archive* ar = openArchive(ar_path);
+			try {
+				struct archive_entry* entry = nullptr;
+				for (int rr = archive_read_next_header(ar, &entry);
+				     rr != ARCHIVE_EOF && entries.size() + stored.size() < entry_pathnames.size();
+				     rr = archive_read_next_header(ar, &entry))
+				{
+					if (rr != ARCHIVE_OK)
+					{
+						throw std::runtime_error("Archive not OK");
+					}
+					string filename(archive_entry_pathname(entry));
+					if (entry_pathnames.count(filename) != 0
+					    && stored.count(filename) == 0
+					    && entries.count(filename) == 0) {
+						entries[filename] = archiveEntryData(ar, entry, filename);
+					}
+				}
+			}
+			catch (...) {
+				closeArchive(ar);
+				throw;
+			}
+			closeArchive(ar);
+		}
+		ArIndex(ArIndex const &) = delete;
+		ArIndex &operator=(ArIndex const &) = delete;
+
+		/**
+		 * The data of an entry, for loaders that keep using it after
+		 * loading: entries stored uncompressed point into the mapping
+		 * of the archive, which they keep mapped; others are copied.
+		 */
+		SharedBytes shared(const string& entry_pathname) const
+		{
+			const auto& st = stored.find(entry_pathname);
+			if (st != stored.end()) {
+				return { std::shared_ptr<const char>(mapped, mapped->data + st->second.first), st->second.second };
+			}
+			const auto& it = entries.find(entry_pathname);
+			if (it == entries.end()) {
+				throw std::runtime_error("libdivvun: ERROR: Couldn't find " + entry_pathname + " in archive");
+			}
+			return copyBytes(it->second);
+		}
+
+		template<typename Ret>
+		Ret extract(const string& entry_pathname, ArEntryHandler<Ret>procFile) const
+		{
+			const auto& st = stored.find(entry_pathname);
+			if (st != stored.end()) {
+				return procFile(ar_path, mapped->data + st->second.first, st->second.second);
+			}
+			const auto& it = entries.find(entry_pathname);
+			if (it == entries.end()) {
+				throw std::runtime_error("libdivvun: ERROR: Couldn't find " + entry_pathname + " in archive");
+			}
+			return procFile(ar_path, it->second.c_str(), it->second.size());
+		}
+
+		const string ar_path;
+	private:
+		const std::shared_ptr<const MappedFile> mapped;
+		// offset and size in mapped:
+		std::unordered_map<string, std::pair<size_t, size_t>> stored;
+		std::unordered_map<string, string> entries;
+};
 #else
 template<typename Ret>
 Ret readArchiveExtract(const string& ar_path,
@@ -186,6 +418,25 @@ Ret readArchiveExtract(const string& ar_path,
 {
 	throw std::runtime_error("libdivvun: ERROR: Can't extract zipped archives -- this library has been compiled without libarchive support. Please ensure libarchive is installed, and recompile divvun-gramcheck with --enable-checker.");
 }
+
+class ArIndex {
+	public:
+		ArIndex(const string& ar_path_, const std::set<string>& entry_pathnames)
+			: ar_path(ar_path_)
+		{
+			throw std::runtime_error("libdivvun: ERROR: Can't extract zipped archives -- this library has been compiled without libarchive support. Please ensure libarchive is installed, and recompile divvun-gramcheck with --enable-checker.");
+		}
+		SharedBytes shared(const string& entry_pathname) const
+		{
+			throw std::runtime_error("libdivvun: ERROR: Can't extract zipped archives -- this library has been compiled without libarchive support.");
+		}
+		template<typename Ret>
+		Ret extract(const string& entry_pathname, ArEntryHandler<Ret>procFile) const
+		{
+			throw std::runtime_error("libdivvun: ERROR: Can't extract zipped archives -- this library has been compiled without libarchive support.");
+		}
+		const string ar_path;
+};
 #endif	// HAVE_LIBARCHIVE
 
 
@@ -0,0 +1,378 @@
+/*
+* Copyright (C) 2026, Kevin Brubeck Unhammer <unhammer@fsfe.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Serving one loaded Pipeline to many clients, over stdin/stdout or a
+// Unix-domain socket
+
+
+#pragma once
+#ifndef f3a0c5d81e6b2947_SERVER_H
+#	define f3a0c5d81e6b2947_SERVER_H
+
+#	include <cerrno>
+#	include <condition_variable>
+#	include <cstring>
+#	include <memory>
+#	include <mutex>
+#	include <stdexcept>
+#	include <string>
+#	include <thread>
+#	include <vector>
+#	include <fcntl.h>
+#	include <sys/socket.h>
+#	include <sys/stat.h>
+#	include <sys/un.h>
+#	include <unistd.h>
+
+// divvun-gramcheck:
+#	include "pipeline.hpp"
+#	include "workqueue.hpp"
+
+namespace divvun {
+
+/**
+ * One client: requests are read from in_fd and responses written to
+ * out_fd, both as frames of
+ *
+ *     ID LENGTH\n
+ *     LENGTH bytes of text\n
+ *
+ * where ID is any word the client likes. A response has "ok" or
+ * "error" between ID and LENGTH, and the pipeline output or an error
+ * message as text. Responses may be written from any thread.
+ */
+class ServerConn {
+public:
+	ServerConn(int in_fd_, int out_fd_, bool close_fds_)
+	  : in_fd(in_fd_)
+	  , out_fd(out_fd_)
+	  , close_fds(close_fds_)
+	  , out_socket(isSocket(out_fd_)) {
+		// A client closing its end shouldn't kill the server:
+#	ifndef MSG_NOSIGNAL
+		if (out_socket) {
+			const int on = 1;
+			setsockopt(out_fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+		}
+#	endif
+#	ifdef F_SETNOSIGPIPE
+		if (!out_socket) {
+			fcntl(out_fd, F_SETNOSIGPIPE, 1);
+		}
+#	endif
+	}
+	~ServerConn() {
+		if (close_fds) {
+			close(in_fd);
+			if (out_fd != in_fd) {
+				close(out_fd);
+			}
+		}
+	}
+	ServerConn(ServerConn const&) = delete;
+	ServerConn& operator=(ServerConn const&) = delete;
+
+	// Largest request we accept, so a bad header doesn't make us try
+	// to allocate all memory
+	static constexpr size_t MAX_LENGTH = 64 * 1024 * 1024;
+
+	// Read the next request; false at end of input, throws on
+	// malformed frames (after which nothing more can be read)
+	bool read(string& id, string& text) {
+		string header;
+		if (!readLine(header)) {
+			return false;
+		}
+		const size_t sp = header.find(' ');
+		char* end = nullptr;
+		const auto length = sp == string::npos
+		                      ? 0
+		                      : std::strtoull(header.c_str() + sp + 1, &end, 10);
+		if (sp == 0 || sp == string::npos || end == header.c_str() + sp + 1 ||
+		    *end != '\0' || length > MAX_LENGTH) {
+			throw std::runtime_error(
+			  "libdivvun: ERROR: Expected \"ID LENGTH\" frame header, got \"" +
+			  header + "\"");
+		}
+		id = header.substr(0, sp);
+		if (!readBytes(length + 1, text) || text.back() != '\n') {
+			throw std::runtime_error("libdivvun: ERROR: Request " + id +
+			                         " wasn't " + std::to_string(length) +
+			                         " bytes followed by a newline");
+		}
+		text.pop_back();
+		return true;
+	}
+
+	void respond(const string& id, const char* status, const string& body) {
+		const string frame = id + " " + status + " " +
+		                     std::to_string(body.size()) + "\n" + body + "\n";
+		std::lock_guard<std::mutex> lock(out_mutex);
+		for (size_t done = 0; !broken && done < frame.size();) {
+			const ssize_t n = send(frame.data() + done, frame.size() - done);
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				broken = true; // client went away; drop what's left
+				break;
+			}
+			done += n;
+		}
+	}
+
+	// Count requests handed to workers, so we can wait for their
+	// responses before closing
+	void started() {
+		std::lock_guard<std::mutex> lock(pending_mutex);
+		++pending;
+	}
+	void finished() {
+		std::lock_guard<std::mutex> lock(pending_mutex);
+		if (--pending == 0) {
+			none_pending.notify_all();
+		}
+	}
+	void waitFinished() {
+		std::unique_lock<std::mutex> lock(pending_mutex);
+		none_pending.wait(lock, [this] { return pending == 0; });
+	}
+
+private:
+	const int in_fd;
+	const int out_fd;
+	const bool close_fds;
+	const bool out_socket;
+	string buf;
+	size_t buf_pos = 0;
+	bool eof = false;
+	std::mutex out_mutex;
+	bool broken = false;
+	std::mutex pending_mutex;
+	std::condition_variable none_pending;
+	size_t pending = 0;
+
+	static bool isSocket(int fd) {
+		struct stat st;
+		return fstat(fd, &st) == 0 && S_ISSOCK(st.st_mode);
+	}
+
+	ssize_t send(const char* data, size_t n) {
+#	ifdef MSG_NOSIGNAL
+		if (out_socket) {
+			return ::send(out_fd, data, n, MSG_NOSIGNAL);
+		}
+#	endif
+		return writeNoSigpipe(out_fd, data, n);
+	}
+
+	// Read more into buf; false at end of input
+	bool fill() {
+		if (eof) {
+			return false;
+		}
+		if (buf_pos > 0) {
+			buf.erase(0, buf_pos);
+			buf_pos = 0;
+		}
+		char chunk[65536];
+		for (;;) {
+			const ssize_t n = ::read(in_fd, chunk, sizeof(chunk));
+			if (n < 0 && errno == EINTR) {
+				continue;
+			}
+			if (n <= 0) {
+				eof = true;
+				return false;
+			}
+			buf.append(chunk, n);
+			return true;
+		}
+	}
+
+	bool readLine(string& line) {
+		size_t nl;
+		while ((nl = buf.find('\n', buf_pos)) == string::npos) {
+			if (!fill()) {
+				if (buf_pos < buf.size()) {
+					throw std::runtime_error(
+					  "libdivvun: ERROR: Input ended in the middle of a frame header");
+				}
+				return false;
+			}
+		}
+		line.assign(buf, buf_pos, nl - buf_pos);
+		buf_pos = nl + 1;
+		return true;
+	}
+
+	bool readBytes(size_t n, string& out) {
+		while (buf.size() - buf_pos < n) {
+			if (!fill()) {
+				return false;
+			}
+		}
+		out.assign(buf, buf_pos, n);
+		buf_pos += n;
+		return true;
+	}
+};
+
+/**
+ * Runs requests from any number of connections on a pool of workers,
+ * each with its own clone of the pipeline. A response is written as
+ * soon as it is done, so responses to one connection may come in
+ * another order than the requests; the client matches them by ID.
+ */
+class Server {
+public:
+	Server(Pipeline& pipeline, size_t workers)
+	  : jobs(std::make_shared<BoundedQueue<Job>>(4 * std::max<size_t>(1, workers))) {
+		pipelines.push_back(&pipeline);
+		while (pipelines.size() < std::max<size_t>(1, workers)) {
+			clones.emplace_back(pipeline.clone());
+			pipelines.push_back(clones.back().get());
+		}
+		for (auto* p : pipelines) {
+			threads.emplace_back([this, p] { work(*p); });
+		}
+	}
+	~Server() {
+		jobs->close();
+		for (auto& t : threads) {
+			t.join();
+		}
+	}
+	Server(Server const&) = delete;
+	Server& operator=(Server const&) = delete;
+
+	// The stats of pipeline and all its clones, summed
+	vector<StageStats> stats() const {
+		vector<StageStats> sum = pipelines.front()->stats();
+		for (const auto& clone : clones) {
+			const auto cs = clone->stats();
+			for (size_t i = 0; i < sum.size() && i < cs.size(); ++i) {
+				addStageStats(sum[i], cs[i]);
+			}
+		}
+		return sum;
+	}
+
+	// Serve requests from in_fd until it ends, returning when all of
+	// them are answered
+	void serve(int in_fd, int out_fd) {
+		serveConn(*jobs, std::make_shared<ServerConn>(in_fd, out_fd, false));
+	}
+
+	// Serve every connection made to a Unix-domain socket at path;
+	// only returns by throwing
+	void listen(const string& path) {
+		sockaddr_un addr;
+		std::memset(&addr, 0, sizeof(addr));
+		addr.sun_family = AF_UNIX;
+		if (path.size() >= sizeof(addr.sun_path)) {
+			throw std::runtime_error(
+			  "libdivvun: ERROR: Socket path too long: " + path);
+		}
+		std::strcpy(addr.sun_path, path.c_str());
+		// Replace a socket left over from an earlier run, but nothing else:
+		struct stat st;
+		if (stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+			unlink(path.c_str());
+		}
+		const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+		if (fd < 0 ||
+		    bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0 ||
+		    ::listen(fd, SOMAXCONN) != 0) {
+			const string err = std::strerror(errno);
+			if (fd >= 0) {
+				close(fd);
+			}
+			throw std::runtime_error(
+			  "libdivvun: ERROR: Couldn't listen on " + path + ": " + err);
+		}
+		for (;;) {
+			const int conn = accept(fd, nullptr, nullptr);
+			if (conn < 0) {
+				if (errno == EINTR || errno == ECONNABORTED) {
+					continue;
+				}
+				const string err = std::strerror(errno);
+				close(fd);
+				throw std::runtime_error(
+				  "libdivvun: ERROR: Couldn't accept on " + path + ": " + err);
+			}
+			// Detached, since we never return to join it; so it holds on
+			// to jobs itself, in case we throw and this Server goes away
+			// before the connection ends (pushing then fails, so it
+			// stops reading)
+			std::thread([jobs = jobs, conn] {
+				serveConn(*jobs, std::make_shared<ServerConn>(conn, conn, true));
+			}).detach();
+		}
+	}
+
+private:
+	struct Job {
+		std::shared_ptr<ServerConn> conn;
+		string id;
+		string text;
+	};
+	std::shared_ptr<BoundedQueue<Job>> jobs;
+	vector<unique_ptr<Pipeline>> clones;
+	vector<Pipeline*> pipelines;
+	vector<std::thread> threads;
+
+	static void serveConn(
+	  BoundedQueue<Job>& jobs, std::shared_ptr<ServerConn> conn) {
+		try {
+			for (Job job { conn, "", "" }; conn->read(job.id, job.text);) {
+				conn->started();
+				if (!jobs.push(job)) {
+					conn->finished();
+					break;
+				}
+			}
+		}
+		catch (const std::exception& e) {
+			conn->respond("-", "error", e.what());
+		}
+		conn->waitFinished();
+	}
+
+	void work(Pipeline& pipeline) {
+		Job job;
+		while (jobs->pop(job)) {
+			try {
+				std::stringstream in(job.text);
+				std::stringstream out;
+				pipeline.proc(in, out);
+				job.conn->respond(job.id, "ok", out.str());
+			}
+			catch (const std::exception& e) {
+				job.conn->respond(job.id, "error", e.what());
+			}
+			job.conn->finished();
+			job = Job(); // don't keep the connection open
+		}
+	}
+};
+
+}
+
+#endif
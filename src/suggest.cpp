@@ -16,7 +16,7 @@
 */
 
 #include "suggest.hpp"
-#include <locale>
+#include <mutex>
 
 namespace divvun {
 
@@ -323,8 +323,8 @@ const Reading proc_subreading(const string& line, bool generate_all_readings) {
 };
 
 
-const Reading proc_reading(const hfst::HfstTransducer& generator,
-  const string& line, bool generate_all_readings) {
+const Reading proc_reading(const SharedTransducer& generator,
+  GenerationCache& gencache, const string& line, bool generate_all_readings) {
 	stringstream ss(line);
 	string subline;
 	std::deque<Reading> subs;
@@ -353,16 +353,21 @@ const Reading proc_reading(const hfst::HfstTransducer& generator,
 	}
 	dedupe(r.rels);
 	if (r.suggest) {
-		const HfstPaths1L paths(generator.lookup_fd({ r.ana }, -1, 10.0));
-		for (auto& p : *paths) {
-			stringstream form;
-			for (auto& symbol : p.second) {
-				if (!hfst::FdOperation::is_diacritic(symbol)) {
-					form << symbol;
+		vector<string> forms;
+		if (!gencache.get(r.ana, forms)) {
+			const HfstPaths1L paths(generator.lookup_fd({ r.ana }, -1, 10.0));
+			for (auto& p : *paths) {
+				stringstream form;
+				for (auto& symbol : p.second) {
+					if (!hfst::FdOperation::is_diacritic(symbol)) {
+						form << symbol;
+					}
 				}
+				forms.emplace_back(form.str());
 			}
-			r.sforms.emplace_back(form.str());
+			gencache.put(r.ana, forms);
 		}
+		r.sforms.insert(r.sforms.end(), forms.begin(), forms.end());
 	}
 	return r;
 }
@@ -599,7 +604,7 @@ build_squiggle_replacement(const Reading& r, const ErrId& err_id,
 	std::optional<Casing> addedcasing = std::nullopt;
 	for (size_t i = i_left; i <= i_right; ++i) {
 		const auto& trg = sentence.cohorts[i];
-		Casing casing = getCasing(toUtf8(trg.form));
+		Casing casing = getCasing(trg.form);
 
 		if (verbose)
 			std::cerr << "\033[1;34mi=\t" << i << "\033[0m" << std::endl;
@@ -628,7 +633,7 @@ build_squiggle_replacement(const Reading& r, const ErrId& err_id,
 				const auto& right_of_trg = sentence.cohorts[j];
 				if (!right_of_trg.added) {
 					addedcasing = casing;
-					casing = getCasing(toUtf8(right_of_trg.form));
+					casing = getCasing(right_of_trg.form);
 					break;
 				}
 			}
@@ -693,9 +698,7 @@ build_squiggle_replacement(const Reading& r, const ErrId& err_id,
 		} // end for readings of target
 
 		if (rep_this_trg.empty()) {
-			const auto cased_sf =
-			  fromUtf8(withCasing(fixedcase, casing, toUtf8(trg.form)));
-			rep_this_trg.push_back(cased_sf);
+			rep_this_trg.push_back(withCasing(fixedcase, casing, trg.form));
 		}
 		beg = std::min(beg, trg_beg);
 		end = std::max(end, trg_end);
@@ -746,67 +749,38 @@ variant<Nothing, Err> Suggest::cohort_errs(const ErrId& err_id, size_t i_c,
 		return Nothing();
 	}
 	// Begin set msg:
-	Msg msg;
-	for (const auto& mlang : sortedmsglangs) {
-		if (msg.second.empty() && mlang != locale) {
-			std::cerr << "divvun-suggest: WARNING: No <description> for "
-			          << json::str(err_id) << " in xml:lang '" << locale
-			          << "', trying '" << mlang << "'" << std::endl;
-		}
-		const auto& lmsgs = msgs.at(mlang);
-		if (lmsgs.first.count(err_id) != 0) {
-			msg = lmsgs.first.at(err_id);
-		}
-		else {
-			for (const auto& p : lmsgs.second) {
-				std::match_results<const char*> result;
-				const auto& et = toUtf8(err_id.c_str());
-				std::regex_match(et.c_str(), result, p.first);
-				if (!result.empty() && // Only consider full matches:
-				    result.position(0) == 0 && result.suffix().length() == 0) {
-					msg = p.second;
-					break;
-					// TODO: cache results? but then no more constness:
-					// lmsgs.first.at(errId) = p.second;
-				}
-			}
-		}
-		if (!msg.second.empty()) {
-			break;
-		}
+	const auto& resolved = msgresolver->resolve(err_id);
+	for (const auto& mlang : resolved.fallbacks) {
+		std::cerr << "divvun-suggest: WARNING: No <description> for "
+		          << json::str(err_id) << " in xml:lang '" << locale
+		          << "', trying '" << mlang << "'" << std::endl;
 	}
-	if (msg.second.empty()) {
+	if (!resolved.found) {
 		std::cerr << "divvun-suggest: WARNING: No <description> for "
 		          << json::str(err_id) << " in any xml:lang" << std::endl;
-		msg.second = err_id;
 	}
-	if (msg.first.empty()) {
-		msg.first = err_id;
-	}
-	// TODO: Make suitable structure on creating MsgMap instead?
-	replaceAll(msg.first, u"$1", c.form);
-	replaceAll(msg.second, u"$1", c.form);
+	// Relation forms for the $N placeholders; from the first reading
+	// that has the relation, joined if it has several targets:
+	std::unordered_map<u16string, u16string> msg_replacements;
 	for (const auto& r : c.readings) {
 		if ((!r.errtypes.empty()) &&
 		    r.errtypes.find(err_id) == r.errtypes.end()) {
 			continue; // there is some other error on this reading
 		}
-		// Since we can have multiple relation targets, we first collect them, then apply them:
-		std::unordered_map<string, u16string> msg_replacements;
+		std::unordered_map<u16string, u16string> reading_replacements;
 		rel_on_match(r.rels, MSG_TEMPLATE_REL, sentence,
 		  [&](const string& relname, size_t i_t, const Cohort& trg) {
-			  if (msg_replacements.find(relname) == msg_replacements.end()) {
-				  msg_replacements[relname] = trg.form;
+			  const auto& name = fromUtf8(relname);
+			  const auto it = reading_replacements.find(name);
+			  if (it == reading_replacements.end()) {
+				  reading_replacements[name] = trg.form;
 			  }
 			  else {
-				  msg_replacements[relname] =
-				    msg_replacements[relname] + u", " + trg.form;
+				  it->second = it->second + u", " + trg.form;
 			  }
 		  });
-		for (const auto& rep : msg_replacements) {
-			replaceAll(msg.first, fromUtf8(rep.first), rep.second);
-			replaceAll(msg.second, fromUtf8(rep.first), rep.second);
-		}
+		msg_replacements.insert(
+		  reading_replacements.begin(), reading_replacements.end());
 	}
 	// End set msg
 	// Begin set beg, end, form, rep:
@@ -842,10 +816,10 @@ variant<Nothing, Err> Suggest::cohort_errs(const ErrId& err_id, size_t i_c,
 	  rep.end());
 	// No duplicates:
 	rep.erase(Dedupe(rep.begin(), rep.end()), rep.end());
-	if (!rep.empty()) {
-		replaceAll(msg.first, u"€1", rep[0]);
-		replaceAll(msg.second, u"€1", rep[0]);
-	}
+	const Msg msg = {
+		resolved.title.fill(c.form, msg_replacements, rep),
+		resolved.description.fill(c.form, msg_replacements, rep),
+	};
 	return Err{ form, beg, end, err_id, msg, rep };
 }
 
@@ -903,14 +877,13 @@ Sentence Suggest::run_sentence(std::istream& is, FlushOn flush_on) {
 	std::getline(is,
 	  line); // TODO: Why do I need at least one getline before os<< after flushing?
 	do {
-		std::match_results<const char*> result;
-		std::regex_match(line.c_str(), result, CG_LINE);
+		const CGLine cg = lexCGLine(line.c_str());
 
 		if (!readinglines.empty() && // Reached end of readings
-		    (result.empty() ||
-		      (result[3].length() <= 1 && result[8].length() <= 1))) {
+		    (cg.type == CGLine::Unmatched ||
+		      (cg.subs.size() <= 1 && cg.trace.size() <= 1))) {
 			const auto& reading =
-			  proc_reading(*generator, readinglines, generate_all_readings);
+			  proc_reading(*generator, *gencache, readinglines, generate_all_readings);
 			readinglines = "";
 			c.errtypes.insert(
 			  reading.errtypes.begin(), reading.errtypes.end());
@@ -936,9 +909,8 @@ Sentence Suggest::run_sentence(std::istream& is, FlushOn flush_on) {
 			}
 		}
 
-		if (!result.empty() &&
-		    ((result[2].length() != 0) // wordform or blank: reset Cohort
-		      || result[6].length() != 0)) {
+		if (!cg.surf.empty() // wordform or blank: reset Cohort
+		    || !cg.blank.empty()) {
 			c.pos = pos;
 			if (!cohort_empty(c)) {
 				std::swap(c.raw_pre_blank, raw_blank);
@@ -950,28 +922,27 @@ Sentence Suggest::run_sentence(std::istream& is, FlushOn flush_on) {
 			}
 			if (c.added == NotAdded) {
 				pos += c.form.size();
-				sentence.text << toUtf8(c.form);
+				sentence.text += c.form;
 			}
 			c = DEFAULT_COHORT;
 		}
 
-		if (!result.empty() && result[2].length() != 0) { // wordform
-			c.form = fromUtf8(result[2]);
+		if (!cg.surf.empty()) { // wordform
+			c.form = fromUtf8(string(cg.surf));
 		}
-		else if (!result.empty() && result[3].length() != 0) { // reading
+		else if (!cg.subs.empty()) { // reading
 			readinglines += line + "\n";
 		}
-		else if (!result.empty() && result[6].length() != 0) { // blank
+		else if (!cg.blank.empty()) { // blank
 			raw_blank.append(line);
-			const auto blank = clean_blank(result[6]);
-			pos += fromUtf8(blank).size();
-			sentence.text << blank;
+			const auto blank = fromUtf8(clean_blank(string(cg.blank)));
+			pos += blank.size();
+			sentence.text += blank;
 		}
-		else if (!result.empty() && result[7].length() != 0) { // flush
+		else if (cg.type == CGLine::Flush) {
 			sentence.runstate = Flushing;
 		}
-		else if (!result.empty() &&
-		         result[8].length() != 0) { // traced removed reading
+		else if (!cg.trace.empty()) { // traced removed reading
 			c.trace_removed_readings += line + "\n";
 		}
 		else {
@@ -984,7 +955,7 @@ Sentence Suggest::run_sentence(std::istream& is, FlushOn flush_on) {
 
 	if (!readinglines.empty()) {
 		const auto& reading =
-		  proc_reading(*generator, readinglines, generate_all_readings);
+		  proc_reading(*generator, *gencache, readinglines, generate_all_readings);
 		readinglines = "";
 		c.errtypes.insert(reading.errtypes.begin(), reading.errtypes.end());
 		c.coerrtypes.insert(
@@ -1007,7 +978,7 @@ Sentence Suggest::run_sentence(std::istream& is, FlushOn flush_on) {
 	}
 	if (c.added == NotAdded) {
 		pos += c.form.size();
-		sentence.text << toUtf8(c.form);
+		sentence.text += c.form;
 	}
 	sentence.raw_final_blank = raw_blank;
 
@@ -1037,59 +1008,70 @@ bool compareByEnd(const Err& a, const Err& b) {
  * [["dego lávvomuorran",0,17,"syn-not-dego","Remove dego when essive",["lávvomuorran"]]
  * ,["dego lávvomuorran",0,17,"syn-dego-nom","Nominative after dego",["dego lávvomuorran"]]]
  *
- * Unfortunately, naïve interval-checking is O(2N²). We can perhaps
- * mitigate the blow-up by sending shorter Sentence's in (errors
- * shouldn't cross paragraph boundaries?). Or we could first create an
- * Interval Tree or similar, if this turns out to be a bottleneck.
- * (e.g.
- * https://github.com/ekg/intervaltree/blob/master/IntervalTree.h )
+ * With errs sorted by beg, an err only needs expanding backwards to
+ * the (already expanded) beg of the first earlier err that reaches
+ * it, which a binary search on the running max of ends finds; and
+ * the same goes forwards with errs sorted by end. So this is
+ * O(N log N), giving what comparing every pair of errs would.
  */
 void expand_errs(vector<Err>& errs, const u16string& text) {
 	const auto n = errs.size();
 	if (n < 2) {
 		return;
 	}
-	// First expand "backwards" towards errors with lower beg's:
-	// Since we sort errs by beg, we only have to compare
-	// this.beg against the set of lower beg, and filter out
-	// those that have a lower end than this.beg (or the exact same beg)
+	// First expand "backwards" towards errors with lower beg's.
+	// maxend[j] is the highest end of errs[0..j] (ends don't change
+	// in this pass):
 	std::sort(errs.begin(), errs.end(), compareByBeg);
+	vector<size_t> maxend(n);
+	maxend[0] = errs[0].end;
+	for (size_t j = 1; j < n; ++j) {
+		maxend[j] = std::max(maxend[j - 1], errs[j].end);
+	}
 	for (size_t i = 1; i < n; ++i) {
 		Err& e = errs[i]; // mut
-		for (size_t j = 0; j < i; ++j) {
-			const Err& f = errs[j];
-			if (f.beg < e.beg && f.end >= e.beg) {
-				const size_t len = e.beg - f.beg;
-				const u16string& add = text.substr(f.beg, len);
-				e.form = add + e.form;
-				e.beg = e.beg - len;
-				for (u16string& r : e.rep) {
-					r = add + r;
-				}
+		const size_t j =
+		  std::lower_bound(maxend.begin(), maxend.begin() + i, e.beg) -
+		  maxend.begin();
+		if (j < i && errs[j].beg < e.beg) {
+			const size_t len = e.beg - errs[j].beg;
+			const u16string& add = text.substr(errs[j].beg, len);
+			e.form = add + e.form;
+			e.beg = e.beg - len;
+			for (u16string& r : e.rep) {
+				r = add + r;
 			}
 		}
 	}
-	// Then expand "forwards" towards errors with higher end's:
+	// Then expand "forwards" towards errors with higher end's.
+	// minbeg[j] is the lowest beg of errs[j..n-1] (begs don't change
+	// in this pass):
 	std::sort(errs.begin(), errs.end(), compareByEnd);
+	vector<size_t> minbeg(n);
+	minbeg[n - 1] = errs[n - 1].beg;
+	for (size_t j = n - 1; j > 0; --j) {
+		minbeg[j - 1] = std::min(minbeg[j], errs[j - 1].beg);
+	}
 	for (size_t i = n - 1; i > 0; --i) {
 		Err& e = errs[i - 1]; // mut
-		for (size_t j = n; j > i; --j) {
-			const auto& f = errs[j - 1];
-			if (f.end > e.end && f.beg <= e.end) {
-				const size_t len = f.end - e.end;
-				const u16string& add = text.substr(e.end, len);
-				e.form = e.form + add;
-				e.end = e.end + len;
-				for (u16string& r : e.rep) {
-					r = r + add;
-				}
+		// The last err after e that begins before e ends:
+		const size_t j =
+		  std::upper_bound(minbeg.begin() + i, minbeg.end(), e.end) -
+		  minbeg.begin();
+		if (j > i && errs[j - 1].end > e.end) {
+			const size_t len = errs[j - 1].end - e.end;
+			const u16string& add = text.substr(e.end, len);
+			e.form = e.form + add;
+			e.end = e.end + len;
+			for (u16string& r : e.rep) {
+				r = r + add;
 			}
 		}
 	}
 }
 
 void Suggest::mk_errs(Sentence& sentence) {
-	const u16string& text = fromUtf8(sentence.text.str());
+	const u16string& text = sentence.text;
 	// Preprocessing, demote target &error to co&error:
 	// Sometimes input has &errortag on relation targets instead of
 	// co&errortag. We allow that, but we should then treat it as a
@@ -1148,23 +1130,7 @@ void Suggest::mk_errs(Sentence& sentence) {
 }
 
 vector<Err> Suggest::run_errs(std::istream& is) {
-	std::locale old_locale = std::locale();
-	try {
-		// Use environment locale (we expect some UTF-8 locale) for toUpper/toLower etc.
-		// but C for numbers (to avoid any comma-as-decimal-separator nonsense)
-		std::locale mixed(
-		  std::locale(""), std::locale::classic(), std::locale::numeric);
-		old_locale = std::locale::global(mixed);
-	}
-	catch (const std::runtime_error& e) {
-		std::cerr
-		  << "divvun-suggest: WARNING: Couldn't set global locale \"\" "
-		     "(locale-specific native environment): "
-		  << e.what() << std::endl;
-	}
-	auto result = run_sentence(is, FlushOn::Nul).errs;
-	std::locale::global(old_locale);
-	return result;
+	return run_sentence(is, FlushOn::Nul).errs;
 }
 
 
@@ -1173,21 +1139,32 @@ RunState Suggest::run_json(std::istream& is, std::ostream& os) {
 	Sentence sentence = run_sentence(is, FlushOn::Nul);
 
 	// All processing done, output:
-	os << "{" << json::key(u"errs") << "[";
+	string out = "{";
+	json::append_key(out, u"errs");
+	out += '[';
 	bool wantsep = false;
 	for (const auto& e : sentence.errs) {
 		if (wantsep) {
-			os << ",";
-		}
-		os << "[" << json::str(e.form) << "," << std::to_string(e.beg) << ","
-		   << std::to_string(e.end) << "," << json::str(e.err) << ","
-		   << json::str(e.msg.second) << "," << json::str_arr(e.rep) << ","
-		   << json::str(e.msg.first) << "]";
+			out += ',';
+		}
+		out += '[';
+		json::append_str(out, e.form);
+		out += ',' + std::to_string(e.beg) + ',' + std::to_string(e.end) + ',';
+		json::append_str(out, e.err);
+		out += ',';
+		json::append_str(out, e.msg.second);
+		out += ',';
+		json::append_str_arr(out, e.rep);
+		out += ',';
+		json::append_str(out, e.msg.first);
+		out += ']';
 		wantsep = true;
 	}
-	os << "]"
-	   << "," << json::key(u"text") << json::str(fromUtf8(sentence.text.str()))
-	   << "}";
+	out += "],";
+	json::append_key(out, u"text");
+	json::append_str(out, sentence.text);
+	out += '}';
+	os.write(out.data(), out.size());
 	if (sentence.runstate == Flushing) {
 		os << '\0';
 		os.flush();
@@ -1201,7 +1178,7 @@ RunState Suggest::run_autocorrect(std::istream& is, std::ostream& os) {
 	Sentence sentence = run_sentence(is, FlushOn::Nul);
 
 	size_t offset = 0;
-	u16string text = fromUtf8(sentence.text.str());
+	const u16string& text = sentence.text;
 	for (const auto& e : sentence.errs) {
 		if (e.beg > offset) {
 			os << toUtf8(text.substr(offset, e.beg - offset));
@@ -1281,35 +1258,25 @@ RunState Suggest::run_cg(std::istream& is, std::ostream& os) {
 }
 
 void Suggest::run(std::istream& is, std::ostream& os, RunMode mode) {
-	std::locale old_locale = std::locale();
-	try {
-		// Use environment locale (we expect some UTF-8 locale) for toUpper/toLower etc.
-		// but C for numbers (to avoid any comma-as-decimal-separator nonsense)
-		std::locale mixed(
-		  std::locale(""), std::locale::classic(), std::locale::numeric);
-		old_locale = std::locale::global(mixed);
-	}
-	catch (const std::runtime_error& e) {
-		std::cerr
-		  << "divvun-suggest: WARNING: Couldn't set global locale \"\" "
-		     "(locale-specific native environment): "
-		  << e.what() << std::endl;
-	}
+	// Input ending in a flush has no empty sentence after it (waits
+	// for more input if there might be some):
+	const auto more = [&is]() {
+		return is.peek() != std::char_traits<char>::eof();
+	};
 	switch (mode) {
 	case RunJson:
-		while (run_json(is, os) == Flushing)
+		while (run_json(is, os) == Flushing && more())
 			;
 		break;
 	case RunAutoCorrect:
-		while (run_autocorrect(is, os) == Flushing)
+		while (run_autocorrect(is, os) == Flushing && more())
 			;
 		break;
 	case RunCG:
-		while (run_cg(is, os) == Flushing)
+		while (run_cg(is, os) == Flushing && more())
 			;
 		break;
 	}
-	std::locale::global(old_locale);
 }
 
 SortedMsgLangs sortMessageLangs(const MsgMap& msgs, const string& prefer) {
@@ -1325,30 +1292,197 @@ SortedMsgLangs sortMessageLangs(const MsgMap& msgs, const string& prefer) {
 	return s;
 }
 
+MsgTemplate MsgTemplate::parse(const u16string& msg) {
+	MsgTemplate t;
+	auto literal = [&](const u16string& text) {
+		if (!t.parts.empty() && t.parts.back().kind == Literal) {
+			t.parts.back().text += text;
+		}
+		else {
+			t.parts.push_back({ Literal, text });
+			++t.literal_parts;
+		}
+		t.literal_size += text.size();
+	};
+	auto isDigit = [](char16_t ch) { return ch >= u'0' && ch <= u'9'; };
+	for (size_t i = 0; i < msg.size();) {
+		if (msg[i] == u'$' && i + 1 < msg.size() && isDigit(msg[i + 1])) {
+			size_t j = i + 1;
+			while (j < msg.size() && isDigit(msg[j])) {
+				++j;
+			}
+			if (msg[i + 1] == u'1') { // so $12 is the form followed by 2
+				t.parts.push_back({ Form, {} });
+				if (j > i + 2) {
+					literal(msg.substr(i + 2, j - i - 2));
+				}
+			}
+			else {
+				t.parts.push_back({ Rel, msg.substr(i + 1, j - i - 1) });
+			}
+			i = j;
+		}
+		else if (msg.compare(i, 2, u"€1") == 0) {
+			t.parts.push_back({ Rep, {} });
+			i += 2;
+		}
+		else {
+			const size_t j = msg.find_first_of(u"$€", i + 1);
+			literal(msg.substr(i, j == u16string::npos ? j : j - i));
+			i = j == u16string::npos ? msg.size() : j;
+		}
+	}
+	return t;
+}
+
+u16string MsgTemplate::fill(const u16string& form,
+  const std::unordered_map<u16string, u16string>& rels,
+  const UStringVector& rep) const {
+	u16string out;
+	out.reserve(literal_size + (parts.size() - literal_parts) * form.size());
+	for (const auto& part : parts) {
+		switch (part.kind) {
+		case Literal:
+			out += part.text;
+			break;
+		case Form:
+			out += form;
+			break;
+		case Rep:
+			out += rep.empty() ? u"€1" : rep[0];
+			break;
+		case Rel: {
+			// $23 may be relation $2 followed by 3, or relation $23:
+			bool found = false;
+			for (size_t k = 1; !found && k <= part.text.size(); ++k) {
+				const auto it = rels.find(u"$" + part.text.substr(0, k));
+				if (it != rels.end()) {
+					out += it->second;
+					out += part.text.substr(k);
+					found = true;
+				}
+			}
+			if (!found) {
+				out += u"$" + part.text;
+			}
+			break;
+		}
+		}
+	}
+	return out;
+}
+
+MsgResolver::MsgResolver(
+  std::shared_ptr<const MsgMap> msgs_, const string& locale_)
+  : locale(locale_)
+  , msgs(std::move(msgs_))
+  , sortedmsglangs(sortMessageLangs(*msgs, locale)) {
+	for (const auto& lm : *msgs) {
+		for (const auto& im : lm.second.first) {
+			if (resolved.find(im.first) == resolved.end()) {
+				resolved.emplace(im.first, lookup(im.first));
+			}
+		}
+	}
+}
+
+const MsgResolver::Resolved& MsgResolver::resolve(const ErrId& err_id) const {
+	std::lock_guard<std::mutex> lock(mutex);
+	auto it = resolved.find(err_id);
+	if (it == resolved.end()) {
+		it = resolved.emplace(err_id, lookup(err_id)).first;
+	}
+	return it->second;
+}
+
+MsgResolver::Resolved MsgResolver::lookup(const ErrId& err_id) const {
+	Resolved r { {}, {}, true };
+	Msg& msg = r.msg;
+	for (const auto& mlang : sortedmsglangs) {
+		if (msg.second.empty() && mlang != locale) {
+			r.fallbacks.push_back(mlang);
+		}
+		const auto& lmsgs = msgs->at(mlang);
+		if (lmsgs.first.count(err_id) != 0) {
+			msg = lmsgs.first.at(err_id);
+		}
+		else {
+			const auto& et = toUtf8(err_id.c_str());
+			for (const auto& p : lmsgs.second) {
+				std::match_results<const char*> result;
+				std::regex_match(et.c_str(), result, p.first);
+				if (!result.empty() && // Only consider full matches:
+				    result.position(0) == 0 && result.suffix().length() == 0) {
+					msg = p.second;
+					break;
+				}
+			}
+		}
+		if (!msg.second.empty()) {
+			break;
+		}
+	}
+	if (msg.second.empty()) {
+		r.found = false;
+		msg.second = err_id;
+	}
+	if (msg.first.empty()) {
+		msg.first = err_id;
+	}
+	r.title = MsgTemplate::parse(msg.first);
+	r.description = MsgTemplate::parse(msg.second);
+	return r;
+}
+
+// Approximate bytes used by one entry of a GenerationCache
+size_t generationCacheSize(const string& ana, const vector<string>& forms) {
+	size_t size = 64 + ana.size();
+	for (const auto& f : forms) {
+		size += sizeof(string) + f.size();
+	}
+	return size;
+}
+
 Suggest::Suggest(const hfst::HfstTransducer* generator_, divvun::MsgMap msgs_,
   const string& locale_, bool verbose_, bool genall)
-  : msgs(msgs_)
+  : msgs(std::make_shared<const MsgMap>(std::move(msgs_)))
   , locale(locale_)
-  , sortedmsglangs(sortMessageLangs(msgs, locale))
-  , generator(generator_)
+  , msgresolver(std::make_shared<const MsgResolver>(msgs, locale))
+  , generator(shareTransducer(generator_))
+  , gencache(std::make_shared<GenerationCache>(
+      DEFAULT_GENERATION_CACHE_SIZE, generationCacheSize))
   , delimiters(defaultDelimiters())
   , generate_all_readings(genall)
   , verbose(verbose_) {}
 Suggest::Suggest(const string& gen_path, const string& msg_path,
   const string& locale_, bool verbose_, bool genall)
-  : msgs(readMessages(msg_path))
+  : msgs(std::make_shared<const MsgMap>(readMessages(msg_path)))
   , locale(locale_)
-  , sortedmsglangs(sortMessageLangs(msgs, locale))
-  , generator(readTransducer(gen_path))
+  , msgresolver(std::make_shared<const MsgResolver>(msgs, locale))
+  , generator(shareTransducer(readTransducer(gen_path)))
+  , gencache(std::make_shared<GenerationCache>(
+      DEFAULT_GENERATION_CACHE_SIZE, generationCacheSize))
   , delimiters(defaultDelimiters())
   , generate_all_readings(genall)
   , verbose(verbose_) {}
 Suggest::Suggest(const string& gen_path, const string& locale_, bool verbose_)
-  : locale(locale_)
-  , generator(readTransducer(gen_path))
+  : msgs(std::make_shared<const MsgMap>())
+  , locale(locale_)
+  , msgresolver(std::make_shared<const MsgResolver>(msgs, locale))
+  , generator(shareTransducer(readTransducer(gen_path)))
+  , gencache(std::make_shared<GenerationCache>(
+      DEFAULT_GENERATION_CACHE_SIZE, generationCacheSize))
   , delimiters(defaultDelimiters())
   , verbose(verbose_) {}
 
+void Suggest::setGenerationCacheSize(size_t max_bytes) {
+	gencache->setMaxSize(max_bytes);
+}
+
+CacheStats Suggest::generationCacheStats() const {
+	return gencache->stats();
+}
+
 void Suggest::setIgnores(const std::set<ErrId>& ignores_) {
 	ignores = ignores_;
 }
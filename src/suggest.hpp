@@ -22,6 +22,7 @@
 #	include <algorithm>
 #	include <exception>
 #	include <locale>
+#	include <mutex>
 #	include <regex>
 #	include <string>
 #	include <unordered_map>
@@ -30,9 +31,11 @@
 
 // divvun-gramcheck:
 #	include "util.hpp"
+#	include "casing.hpp"
 #	include "hfst_util.hpp"
 #	include "json.hpp"
 #	include "checkertypes.hpp"
+#	include "lrucache.hpp"
 // xml:
 #	ifdef HAVE_LIBPUGIXML
 #		include <pugixml.hpp>
@@ -91,90 +94,12 @@ inline void dedupe(relations& rels) {
 
 enum Added { NotAdded, AddedEnsureBlanks, AddedAfterBlank, AddedBeforeBlank };
 
-enum Casing { lower, Title, UPPER, mIxed };
-inline Casing getCasing(string input) {
-	if (input.length() < 1) {
-		return mIxed;
-	}
-	std::locale loc;
-	bool seenupper = false;
-	bool seenlower = false;
-	bool fstupper = false;
-	bool nonfstupper = false;
-	for (const auto& c : wideFromUtf8(input)) {
-		if (isupper(c, loc)) {
-			if (seenlower || seenupper) {
-				nonfstupper = true;
-			}
-			else {
-				fstupper = true;
-			}
-			seenupper = true;
-		}
-		if (islower(c, loc)) {
-			seenlower = true;
-		}
-	}
-	if (!seenupper) {
-		return lower;
-	}
-	if (!seenlower) {
-		return UPPER;
-	}
-	if (fstupper && !nonfstupper) {
-		return Title;
-	}
-	else {
-		return mIxed;
-	}
-}
-
-// #ifndef icu TODO
-//
-// Does lots of probably unnecessary encoding-mangling too, but at
-// least it works, if the user locale is OK.
-inline std::string toupper(const string& input) {
-	std::wstring w = wideFromUtf8(input);
-	setlocale(LC_ALL, "");
-	std::transform(w.begin(), w.end(), w.begin(), std::towupper);
-	return wideToUtf8(w);
-}
-
-inline std::string totitle(const string& input) {
-	std::wstring w = wideFromUtf8(input);
-	setlocale(LC_ALL, "");
-	std::transform(w.begin(), w.begin() + 1, w.begin(), std::towupper);
-	return wideToUtf8(w);
-}
-
-inline std::string tolower(const string& input) {
-	std::wstring w = wideFromUtf8(input);
-	setlocale(LC_ALL, "");
-	std::transform(w.begin(), w.begin() + 1, w.begin(), std::towlower);
-	return wideToUtf8(w);
-}
-// #endif
-
-inline std::string withCasing(bool fixedcase, const Casing& inputCasing, const string& input) {
-	if (fixedcase) {
-		return input;
-	}
-	switch (inputCasing) {
-	case Title:
-		return totitle(input);
-	case UPPER:
-		return toupper(input);
-	case mIxed:
-		return input;
-	case lower:
-		return tolower(input);
-	}
-	// should never get to this point
-	return input;
-}
-
 const string clean_blank(const string& raw);
 
+// Expand errs (and their forms and reps) so no two of them overlap
+// only partly; errs ends up sorted by end
+void expand_errs(vector<Err>& errs, const u16string& text);
+
 struct Reading {
 	bool suggest = false;
 	string ana; // for generating suggestions from this reading
@@ -225,9 +150,7 @@ using CohortMap = std::unordered_map<rel_id, size_t>;
 struct Sentence {
 	vector<Cohort> cohorts;
 	CohortMap ids_cohorts;	// mapping from cohort relation id's to their position in Sentence.cohort vector
-	// TODO: can we make this an encoded stringstream? would avoid a lot of from/to_bytes calls
-	// std::basic_ostringstream<char16_t> text;
-	std::ostringstream text;
+	u16string text; // the forms and blanks, as Cohort.pos and Err beg/end index it
 	RunState runstate;
 	string raw_final_blank; // blank after last cohort, in CG stream format (initial colon, brackets, escaped newlines)
 	vector<Err> errs;
@@ -244,6 +167,108 @@ inline const std::set<u16string> defaultDelimiters() {
 	};
 }
 
+/**
+ * Split text into sentences that may be checked one at a time: a
+ * sentence ends after a delimiter followed by whitespace, or after a
+ * line break, and takes along the whitespace up to the next one.
+ * Returns the length of each sentence in UTF-16 units; together they
+ * cover all of text.
+ */
+inline vector<size_t> splitSentences(const u16string& text,
+  const std::set<u16string>& delimiters = defaultDelimiters()) {
+	const auto isSpace = [](char16_t c) {
+		return c == u' ' || c == u'\t' || c == u'\n' || c == u'\r';
+	};
+	vector<size_t> lens;
+	size_t beg = 0;
+	for (size_t i = 0; i < text.size();) {
+		bool end = text[i] == u'\n';
+		if (!end && i + 1 < text.size() && isSpace(text[i + 1])) {
+			for (const auto& d : delimiters) {
+				if (!d.empty() && d.size() <= i + 1 &&
+				    text.compare(i + 1 - d.size(), d.size(), d) == 0) {
+					end = true;
+					break;
+				}
+			}
+		}
+		++i;
+		if (end) {
+			while (i < text.size() && isSpace(text[i])) {
+				++i;
+			}
+			if (i < text.size()) {
+				lens.push_back(i - beg);
+				beg = i;
+			}
+		}
+	}
+	if (beg < text.size()) {
+		lens.push_back(text.size() - beg);
+	}
+	return lens;
+}
+
+/**
+ * A message title or description split into literal text and the
+ * placeholders $1 (the wordform), $N (the forms of the cohorts that
+ * relation $N points to) and €1 (the first suggestion), so it can be
+ * filled in with one pass over it.
+ */
+struct MsgTemplate {
+	enum Kind { Literal, Form, Rel, Rep };
+	struct Part {
+		Kind kind;
+		u16string text; // Literal text, or the digits after $ of a Rel
+	};
+	vector<Part> parts;
+	size_t literal_parts = 0;
+	size_t literal_size = 0; // for reserving the filled-in size
+
+	static MsgTemplate parse(const u16string& msg);
+	// rels maps relation names (like u"$2") to forms; placeholders
+	// that have nothing to fill them are left as they are
+	u16string fill(const u16string& form,
+	  const std::unordered_map<u16string, u16string>& rels,
+	  const UStringVector& rep) const;
+};
+
+/**
+ * Finds the message for an ErrId: from the preferred language if it
+ * has one, else from the first other language that does, trying the
+ * ids of a language before its regexes. Each ErrId is only looked up
+ * once; ids listed in msgs up front, others (matched by regex, or not
+ * found) when first asked for. May be used from several threads.
+ */
+class MsgResolver {
+public:
+	MsgResolver(std::shared_ptr<const MsgMap> msgs, const string& locale);
+	MsgResolver(MsgResolver const&) = delete;
+	MsgResolver& operator=(MsgResolver const&) = delete;
+
+	struct Resolved {
+		Msg msg;                 // with err_id as title/description if none found
+		vector<Lang> fallbacks;  // languages other than locale we had to try
+		bool found;              // false if no language had a description
+		MsgTemplate title;       // msg.first, parsed
+		MsgTemplate description; // msg.second, parsed
+	};
+	// The reference stays valid as long as this MsgResolver
+	const Resolved& resolve(const ErrId& err_id) const;
+
+private:
+	const string locale;
+	const std::shared_ptr<const MsgMap> msgs;
+	const SortedMsgLangs sortedmsglangs; // invariant: contains all and only the keys of msgs
+	mutable std::unordered_map<ErrId, Resolved> resolved;
+	mutable std::mutex mutex;
+	Resolved lookup(const ErrId& err_id) const;
+};
+
+// Surface forms (without flag diacritics) generated from an analysis
+using GenerationCache = LruCache<string, vector<string>>;
+const size_t DEFAULT_GENERATION_CACHE_SIZE = 1 << 20;
+
 class Suggest {
 public:
 	Suggest(const hfst::HfstTransducer* generator, divvun::MsgMap msgs,
@@ -251,6 +276,9 @@ public:
 	Suggest(const string& gen_path, const string& msg_path,
 	  const string& locale, bool verbose, bool generate_all_readings);
 	Suggest(const string& gen_path, const string& locale, bool verbose);
+	// Copies share messages, generator and caches, and start out with
+	// their own copy of the ignores/includes
+	Suggest(const Suggest& other) = default;
 	~Suggest() = default;
 
 	void run(std::istream& is, std::ostream& os, RunMode mode);
@@ -258,20 +286,27 @@ public:
 	vector<Err> run_errs(std::istream& is);
 	void setIgnores(const std::set<ErrId>& ignores);
 	void setIncludes(const std::set<ErrId>& includes);
+	// Remember the forms generated for up to about max_bytes of
+	// analyses; 0 turns it off
+	void setGenerationCacheSize(size_t max_bytes);
+	CacheStats generationCacheStats() const;
+	void setWorkers(size_t workers) { divvun::setWorkers(generator, workers); }
 
 	static const MsgMap readMessages(const string& file);
 	static const MsgMap readMessages(const char* buff, const size_t size);
 
-	const MsgMap msgs;
+	// Shared with any copies of this Suggest:
+	const std::shared_ptr<const MsgMap> msgs;
 	const string locale;
 
 private:
-	const SortedMsgLangs sortedmsglangs; // invariant: contains all and only the keys of msgs
+	const std::shared_ptr<const MsgResolver> msgresolver;
 	RunState run_json(std::istream& is, std::ostream& os);
 	RunState run_autocorrect(std::istream& is, std::ostream& os);
 	RunState run_cg(std::istream& is, std::ostream& os);
 	Sentence run_sentence(std::istream& is, FlushOn flush_on);
-	std::unique_ptr<const hfst::HfstTransducer> generator;
+	std::shared_ptr<const SharedTransducer> generator;
+	std::shared_ptr<GenerationCache> gencache;
 	std::set<ErrId> ignores;
 	std::set<ErrId> includes;
 	std::set<u16string> delimiters; // run_sentence(NulAndDelimiters) will return after seeing a cohort with one of these forms
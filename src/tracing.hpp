@@ -0,0 +1,126 @@
+/*
+* Copyright (C) 2026, Kevin Brubeck Unhammer <unhammer@fsfe.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Writing spans of pipeline runs in the Chrome trace event format,
+// for chrome://tracing or https://ui.perfetto.dev
+
+
+#pragma once
+#ifndef d5d2b8e0f7a1c934_TRACING_H
+#	define d5d2b8e0f7a1c934_TRACING_H
+
+#	include <atomic>
+#	include <chrono>
+#	include <cstdlib>
+#	include <fstream>
+#	include <iomanip>
+#	include <memory>
+#	include <mutex>
+#	include <stdexcept>
+#	include <string>
+#	include <unistd.h>
+
+// divvun-gramcheck:
+#	include "json.hpp"
+#	include "util.hpp"
+
+namespace divvun {
+
+/**
+ * A JSON array of trace events in a file, closed when the last
+ * pipeline using it is gone. Spans may be added from any thread.
+ */
+class TraceWriter {
+public:
+	explicit TraceWriter(const std::string& path)
+	  : out(path)
+	  , start(std::chrono::steady_clock::now())
+	  , pid(getpid()) {
+		if (!out) {
+			throw std::runtime_error(
+			  "libdivvun: ERROR: Couldn't open trace file " + path);
+		}
+		out << "[" << std::fixed << std::setprecision(3);
+	}
+	~TraceWriter() { out << "\n]\n"; }
+	TraceWriter(TraceWriter const&) = delete;
+	TraceWriter& operator=(TraceWriter const&) = delete;
+
+	// Set in the environment to get a trace without changing code
+	static constexpr const char* ENV_VAR = "DIVVUN_TRACE_OUT";
+
+	// The writer for the file named by ENV_VAR, shared by everyone
+	// in this process asking for it while it exists; nullptr if unset
+	static std::shared_ptr<TraceWriter> fromEnv() {
+		const char* path = std::getenv(ENV_VAR);
+		if (path == nullptr || *path == '\0') {
+			return nullptr;
+		}
+		static std::mutex env_mutex;
+		static std::weak_ptr<TraceWriter> env_writer;
+		std::lock_guard<std::mutex> lock(env_mutex);
+		auto writer = env_writer.lock();
+		if (!writer) {
+			writer = std::make_shared<TraceWriter>(path);
+			env_writer = writer;
+		}
+		return writer;
+	}
+
+	// A new request id, unique within this trace
+	size_t nextRequest() { return ++requests; }
+
+	// Microseconds since the trace was started
+	double now() const {
+		return std::chrono::duration<double, std::micro>(
+		  std::chrono::steady_clock::now() - start)
+		  .count();
+	}
+
+	// Add a complete event from beg to end (as given by now) on the
+	// calling thread
+	void span(const std::string& name, const char* cat, size_t request,
+	  double beg, double end) {
+		const auto tid = threadId();
+		std::lock_guard<std::mutex> lock(mutex);
+		out << (first ? "\n" : ",\n") << "{\"name\":" << json::str(name)
+		    << ",\"cat\":\"" << cat << "\",\"ph\":\"X\",\"ts\":" << beg
+		    << ",\"dur\":" << end - beg << ",\"pid\":" << pid
+		    << ",\"tid\":" << tid << ",\"args\":{\"request\":" << request
+		    << "}}";
+		first = false;
+	}
+
+private:
+	// Small numbers are easier to read in the viewers than native ids
+	static size_t threadId() {
+		static std::atomic<size_t> threads(0);
+		thread_local const size_t id = ++threads;
+		return id;
+	}
+	std::mutex mutex;
+	std::ofstream out;
+	bool first = true;
+	std::atomic<size_t> requests { 0 };
+	const std::chrono::steady_clock::time_point start;
+	const pid_t pid;
+};
+
+}
+
+#endif
@@ -0,0 +1,312 @@
+/*
+* Copyright (C) 2026, Kevin Brubeck Unhammer <unhammer@fsfe.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Validating UTF-8 <-> UTF-16 conversion, with runs of ASCII copied
+// 16 or 32 at a time using SSE2/AVX2 where available
+
+
+#pragma once
+#ifndef d81c5f0a3e7b2946_TRANSCODE_H
+#	define d81c5f0a3e7b2946_TRANSCODE_H
+
+#	include <cstdint>
+#	include <cstring>
+#	include <string>
+
+#	include <utf8.h>
+
+#	if defined(__x86_64__) || (defined(__i386__) && defined(__SSE2__))
+#		define DIVVUN_TRANSCODE_X86 1
+#		include <immintrin.h>
+#	endif
+
+namespace divvun {
+
+namespace transcode {
+
+// A set of conversion kernels for one instruction set
+struct Kernels {
+	const char* isa;
+	/**
+	 * widen (char → char16_t) and narrow (char16_t → char) copy the
+	 * longest run of ASCII at the start of in, as far as it can be
+	 * done in whole blocks, returning how many units were copied; the
+	 * callers take care of the rest one code point at a time.
+	 */
+	size_t (*widen)(const char* in, size_t n, char16_t* out);
+	size_t (*narrow)(const char16_t* in, size_t n, char* out);
+};
+
+inline size_t widenScalar(const char* in, size_t n, char16_t* out) {
+	size_t k = 0;
+	for (; k + 8 <= n; k += 8) {
+		uint64_t w;
+		std::memcpy(&w, in + k, 8);
+		if ((w & 0x8080808080808080ULL) != 0) {
+			break;
+		}
+		for (size_t j = 0; j < 8; ++j) {
+			out[k + j] = (unsigned char)in[k + j];
+		}
+	}
+	return k;
+}
+
+inline size_t narrowScalar(const char16_t* in, size_t n, char* out) {
+	size_t k = 0;
+	for (; k + 4 <= n; k += 4) {
+		uint64_t w;
+		std::memcpy(&w, in + k, 8);
+		if ((w & 0xFF80FF80FF80FF80ULL) != 0) {
+			break;
+		}
+		for (size_t j = 0; j < 4; ++j) {
+			out[k + j] = (char)in[k + j];
+		}
+	}
+	return k;
+}
+
+#	ifdef DIVVUN_TRANSCODE_X86
+inline size_t widenSse2(const char* in, size_t n, char16_t* out) {
+	const __m128i zero = _mm_setzero_si128();
+	size_t k = 0;
+	for (; k + 16 <= n; k += 16) {
+		const __m128i v = _mm_loadu_si128((const __m128i*)(in + k));
+		if (_mm_movemask_epi8(v) != 0) {
+			break;
+		}
+		_mm_storeu_si128((__m128i*)(out + k), _mm_unpacklo_epi8(v, zero));
+		_mm_storeu_si128((__m128i*)(out + k + 8), _mm_unpackhi_epi8(v, zero));
+	}
+	return k;
+}
+
+inline size_t narrowSse2(const char16_t* in, size_t n, char* out) {
+	const __m128i high = _mm_set1_epi16((short)0xFF80);
+	size_t k = 0;
+	for (; k + 16 <= n; k += 16) {
+		const __m128i a = _mm_loadu_si128((const __m128i*)(in + k));
+		const __m128i b = _mm_loadu_si128((const __m128i*)(in + k + 8));
+		const __m128i h = _mm_and_si128(_mm_or_si128(a, b), high);
+		if (_mm_movemask_epi8(_mm_cmpeq_epi16(h, _mm_setzero_si128())) !=
+		    0xFFFF) {
+			break;
+		}
+		_mm_storeu_si128((__m128i*)(out + k), _mm_packus_epi16(a, b));
+	}
+	return k;
+}
+
+__attribute__((target("avx2"))) inline size_t widenAvx2(
+  const char* in, size_t n, char16_t* out) {
+	size_t k = 0;
+	for (; k + 32 <= n; k += 32) {
+		const __m256i v = _mm256_loadu_si256((const __m256i*)(in + k));
+		if (_mm256_movemask_epi8(v) != 0) {
+			break;
+		}
+		_mm256_storeu_si256((__m256i*)(out + k),
+		  _mm256_cvtepu8_epi16(_mm256_castsi256_si128(v)));
+		_mm256_storeu_si256((__m256i*)(out + k + 16),
+		  _mm256_cvtepu8_epi16(_mm256_extracti128_si256(v, 1)));
+	}
+	return k + widenSse2(in + k, n - k, out + k);
+}
+
+__attribute__((target("avx2"))) inline size_t narrowAvx2(
+  const char16_t* in, size_t n, char* out) {
+	const __m256i high = _mm256_set1_epi16((short)0xFF80);
+	size_t k = 0;
+	for (; k + 32 <= n; k += 32) {
+		const __m256i a = _mm256_loadu_si256((const __m256i*)(in + k));
+		const __m256i b = _mm256_loadu_si256((const __m256i*)(in + k + 16));
+		if (!_mm256_testz_si256(_mm256_or_si256(a, b), high)) {
+			break;
+		}
+		// packus works per 128-bit lane, so put the quarters back in order:
+		_mm256_storeu_si256((__m256i*)(out + k),
+		  _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8));
+	}
+	return k + narrowSse2(in + k, n - k, out + k);
+}
+#	endif
+
+inline Kernels detectKernels() {
+#	ifdef DIVVUN_TRANSCODE_X86
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		return { "avx2", widenAvx2, narrowAvx2 };
+	}
+	return { "sse2", widenSse2, narrowSse2 };
+#	else
+	return { "scalar", widenScalar, narrowScalar };
+#	endif
+}
+
+// The best kernels this CPU supports, picked on first use
+inline const Kernels& kernels() {
+	static const Kernels k = detectKernels();
+	return k;
+}
+
+[[noreturn]] inline void invalidUtf8(unsigned char b) {
+	throw utf8::invalid_utf8(b);
+}
+
+[[noreturn]] inline void invalidUtf16(char16_t u) {
+	throw utf8::invalid_utf16(u);
+}
+
+/**
+ * Decode the sequence starting with the non-ASCII byte in[i] and step
+ * i past it. Throws what utf8cpp throws: utf8::not_enough_room if the
+ * text ends inside the sequence, utf8::invalid_code_point for
+ * surrogates and values above U+10FFFF, and utf8::invalid_utf8 for
+ * other bad bytes (including overlong forms).
+ */
+inline char32_t decodeUtf8(const char* in, size_t n, size_t& i) {
+	const auto b = (unsigned char)in[i];
+	// 0xC0, 0xC1 and 0xF5 and up can only start invalid sequences:
+	const size_t len =
+	  b < 0xC2 ? 0 : b < 0xE0 ? 2 : b < 0xF0 ? 3 : b < 0xF5 ? 4 : 0;
+	if (len == 0) {
+		invalidUtf8(b);
+	}
+	const char32_t min = len == 2 ? 0x80 : len == 3 ? 0x800 : 0x10000;
+	char32_t c = b & (0x7F >> len);
+	for (size_t j = 1; j < len; ++j) {
+		if (i + j >= n) {
+			throw utf8::not_enough_room();
+		}
+		const auto cb = (unsigned char)in[i + j];
+		if ((cb & 0xC0) != 0x80) {
+			invalidUtf8(cb);
+		}
+		c = (c << 6) | (cb & 0x3F);
+	}
+	if (c > 0x10FFFF || (c >= 0xD800 && c < 0xE000)) {
+		throw utf8::invalid_code_point(c);
+	}
+	if (c < min) {
+		invalidUtf8(b);
+	}
+	i += len;
+	return c;
+}
+
+/**
+ * Convert from into to (replacing its contents) with the given
+ * kernels. Throws as decodeUtf8 on invalid UTF-8.
+ */
+inline void utf8To16(const std::string& from, std::u16string& to,
+  const Kernels& kern = kernels()) {
+	const size_t n = from.size();
+	to.resize(n); // never more units than bytes
+	const char* in = from.data();
+	char16_t* out = &to[0];
+	size_t i = 0;
+	size_t o = 0;
+	while (i < n) {
+		const size_t k = kern.widen(in + i, n - i, out + o);
+		i += k;
+		o += k;
+		if (i == n) {
+			break;
+		}
+		const auto b = (unsigned char)in[i];
+		if (b < 0x80) {
+			out[o++] = b;
+			++i;
+			continue;
+		}
+		const char32_t c = decodeUtf8(in, n, i);
+		if (c < 0x10000) {
+			out[o++] = (char16_t)c;
+		}
+		else {
+			out[o++] = (char16_t)(0xD800 + ((c - 0x10000) >> 10));
+			out[o++] = (char16_t)(0xDC00 + ((c - 0x10000) & 0x3FF));
+		}
+	}
+	to.resize(o);
+}
+
+/**
+ * Append the n units at in to to as UTF-8, with the given kernels.
+ * Throws utf8::invalid_utf16 on unpaired surrogates.
+ */
+inline void appendUtf8(const char16_t* in, size_t n, std::string& to,
+  const Kernels& kern = kernels()) {
+	const size_t start = to.size();
+	to.resize(start + 3 * n); // a surrogate pair is 4 bytes for 2 units
+	char* out = &to[0];
+	size_t i = 0;
+	size_t o = start;
+	while (i < n) {
+		const size_t k = kern.narrow(in + i, n - i, out + o);
+		i += k;
+		o += k;
+		if (i == n) {
+			break;
+		}
+		char32_t c = in[i++];
+		if (c >= 0xD800 && c < 0xE000) {
+			if (c >= 0xDC00 || i == n || in[i] < 0xDC00 || in[i] >= 0xE000) {
+				to.resize(start);
+				invalidUtf16((char16_t)c);
+			}
+			c = 0x10000 + ((c - 0xD800) << 10) + (in[i++] - 0xDC00);
+		}
+		if (c < 0x80) {
+			out[o++] = (char)c;
+		}
+		else if (c < 0x800) {
+			out[o++] = (char)(0xC0 | (c >> 6));
+			out[o++] = (char)(0x80 | (c & 0x3F));
+		}
+		else if (c < 0x10000) {
+			out[o++] = (char)(0xE0 | (c >> 12));
+			out[o++] = (char)(0x80 | ((c >> 6) & 0x3F));
+			out[o++] = (char)(0x80 | (c & 0x3F));
+		}
+		else {
+			out[o++] = (char)(0xF0 | (c >> 18));
+			out[o++] = (char)(0x80 | ((c >> 12) & 0x3F));
+			out[o++] = (char)(0x80 | ((c >> 6) & 0x3F));
+			out[o++] = (char)(0x80 | (c & 0x3F));
+		}
+	}
+	to.resize(o);
+}
+
+/**
+ * Convert from into to (replacing its contents) with the given
+ * kernels. Throws utf8::invalid_utf16 on unpaired surrogates.
+ */
+inline void utf16To8(const std::u16string& from, std::string& to,
+  const Kernels& kern = kernels()) {
+	to.clear();
+	appendUtf8(from.data(), from.size(), to, kern);
+}
+
+}
+
+}
+
+#endif
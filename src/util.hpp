@@ -31,13 +31,16 @@
 #	include <vector>
 #	include <set>
 #	include <string>
+#	include <string_view>
 #	include <algorithm>
 #	include <limits>
 
 #	include <locale>
-#	include <codecvt>
 #	include <utf8.h>
 
+// divvun-gramcheck:
+#	include "transcode.hpp"
+
 namespace divvun {
 
 struct CGReading {
@@ -51,48 +54,122 @@ struct CGCohort {
 	std::vector<CGReading*> readings;
 };
 
-const std::basic_regex<char> CG_LINE(
-  "^"
-  "(\"<(.*)>\".*"                             // wordform, group 2
-  "|(\t+)(\"[^\"]*\"\\S*)((?:\\s+\\S+)*)\\s*" // reading, group 3, 4, 5
-  "|:(.*)"                                    // blank, group 6
-  "|(<STREAMCMD:FLUSH>)"                      // flush, group 7
-  "|(;\t+.*)"                                 // traced reading, group 8
-  ")");
-
-const int CG_GROUP_ALL = 1;
-const int CG_GROUP_SURF = 2;
-const int CG_GROUP_SUBS = 3;
-const int CG_GROUP_LEMMA = 4;
-const int CG_GROUP_READINGS = 5;
-const int CG_GROUP_BLANK = 6;
-const int CG_GROUP_STREAMCMD = 7;
-const int CG_GROUP_TRACE = 8;
+/**
+ * One line of CG stream format, as split up by lexCGLine. The views
+ * point into the line that was lexed; parts that don't apply to the
+ * type of line are empty.
+ */
+struct CGLine {
+	enum Type { Unmatched, Wordform, Reading, Blank, Flush, Trace };
+	Type type = Unmatched;
+	std::string_view all;      // the whole line, empty if Unmatched
+	std::string_view surf;     // between "< and the last >"
+	std::string_view subs;     // the tabs before a reading
+	std::string_view lemma;    // "lemma" and any non-space suffix
+	std::string_view readings; // the tags, from the first whitespace
+	std::string_view blank;    // after :
+	std::string_view trace;    // the whole ;\t line of a removed reading
+};
+
+// The whitespace of \s in the C locale
+inline bool isCGSpace(const char c) {
+	return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/**
+ * Split up a line of CG stream format without allocating. This gives
+ * the same parts as matching the whole line against the regex
+ *
+ *   "<(.*)>".*                               wordform
+ *   |(\t+)("[^"]*"\S*)((?:\s+\S+)*)\s*        reading
+ *   |:(.*)                                   blank
+ *   |<STREAMCMD:FLUSH>                       flush
+ *   |;\t+.*                                  traced removed reading
+ *
+ * which we used before; note that . doesn't match \r or \n.
+ */
+inline CGLine lexCGLine(const std::string_view line) {
+	CGLine l;
+	const auto anyDot = [&](size_t from) {
+		return line.find_first_of("\r\n", from) == std::string_view::npos;
+	};
+	const auto match = [&](CGLine::Type type) {
+		l.type = type;
+		l.all = line;
+		return l;
+	};
+	if (line.empty()) {
+		return l;
+	}
+	switch (line[0]) {
+		case '"': {
+			const size_t end = line.rfind(">\"");
+			if (line.size() >= 4 && line[1] == '<' &&
+			    end != std::string_view::npos && end >= 2 && anyDot(2)) {
+				l.surf = line.substr(2, end - 2);
+				return match(CGLine::Wordform);
+			}
+			return l;
+		}
+		case '\t': {
+			const size_t lemma = line.find_first_not_of('\t');
+			if (lemma == std::string_view::npos || line[lemma] != '"') {
+				return l;
+			}
+			size_t lemma_end = line.find('"', lemma + 1);
+			if (lemma_end == std::string_view::npos) {
+				return l;
+			}
+			do {
+				++lemma_end;
+			} while (lemma_end < line.size() && !isCGSpace(line[lemma_end]));
+			size_t tags_end = line.size();
+			while (tags_end > lemma_end && isCGSpace(line[tags_end - 1])) {
+				--tags_end;
+			}
+			l.subs = line.substr(0, lemma);
+			l.lemma = line.substr(lemma, lemma_end - lemma);
+			l.readings = line.substr(lemma_end, tags_end - lemma_end);
+			return match(CGLine::Reading);
+		}
+		case ':':
+			if (anyDot(1)) {
+				l.blank = line.substr(1);
+				return match(CGLine::Blank);
+			}
+			return l;
+		case '<':
+			if (line == "<STREAMCMD:FLUSH>") {
+				return match(CGLine::Flush);
+			}
+			return l;
+		case ';':
+			if (line.size() >= 2 && line[1] == '\t' && anyDot(1)) {
+				l.trace = line;
+				return match(CGLine::Trace);
+			}
+			return l;
+		default:
+			return l;
+	}
+}
 
 using StringVec = std::vector<std::string>;
 
+// Throws utf8::invalid_utf16 on unpaired surrogates
 inline const std::string toUtf8(const std::u16string& from) {
 	std::string to;
-	utf8::utf16to8(from.begin(), from.end(), std::back_inserter(to));
+	transcode::utf16To8(from, to);
 	return to;
 }
 
+// Throws a utf8::exception on invalid UTF-8
 inline const std::u16string fromUtf8(const std::string& from) {
 	std::u16string to;
-	utf8::utf8to16(from.begin(), from.end(), std::back_inserter(to));
+	transcode::utf8To16(from, to);
 	return to;
 }
 
-inline const std::wstring wideFromUtf8(const std::string& str) {
-	std::wstring_convert<std::codecvt_utf8<wchar_t>> myconv;
-	return myconv.from_bytes(str);
-}
-
-inline const std::string wideToUtf8(const std::wstring& str) {
-	std::wstring_convert<std::codecvt_utf8<wchar_t>> myconv;
-	return myconv.to_bytes(str);
-}
-
 template<typename Container>
 inline const std::string join_quoted(
   const Container& ss, const std::string& delim = " ") {
@@ -0,0 +1,206 @@
+/*
+* Copyright (C) 2026, Kevin Brubeck Unhammer <unhammer@fsfe.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Small thread-safe queues for passing work between threads, and
+// pools of objects that only one thread may use at a time
+
+
+#pragma once
+#ifndef c4e0f21b9a7d3e58_WORKQUEUE_H
+#	define c4e0f21b9a7d3e58_WORKQUEUE_H
+
+#	include <algorithm>
+#	include <condition_variable>
+#	include <cstddef>
+#	include <deque>
+#	include <functional>
+#	include <memory>
+#	include <mutex>
+#	include <vector>
+
+namespace divvun {
+
+/**
+ * A FIFO with a fixed capacity. push blocks while the queue is full,
+ * pop blocks while it is empty.
+ *
+ * close() means no more items will be pushed; consumers still get
+ * what is queued before pop returns false. cancel() also throws away
+ * whatever is queued, so that both sides stop as soon as possible
+ * (used when some stage has failed).
+ */
+template<typename T> class BoundedQueue {
+public:
+	explicit BoundedQueue(std::size_t capacity_)
+	  : capacity(capacity_ == 0 ? 1 : capacity_) {}
+	BoundedQueue(BoundedQueue const&) = delete;
+	BoundedQueue& operator=(BoundedQueue const&) = delete;
+
+	// Returns false (and drops item) if the queue was closed
+	bool push(T item) {
+		std::unique_lock<std::mutex> lock(mutex);
+		not_full.wait(lock, [this] { return closed || items.size() < capacity; });
+		if (closed) {
+			return false;
+		}
+		items.push_back(std::move(item));
+		not_empty.notify_one();
+		return true;
+	}
+
+	// Returns false once the queue is closed and drained
+	bool pop(T& item) {
+		std::unique_lock<std::mutex> lock(mutex);
+		not_empty.wait(lock, [this] { return closed || !items.empty(); });
+		if (items.empty()) {
+			return false;
+		}
+		item = std::move(items.front());
+		items.pop_front();
+		not_full.notify_one();
+		return true;
+	}
+
+	void close() {
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		not_empty.notify_all();
+		not_full.notify_all();
+	}
+
+	void cancel() {
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		items.clear();
+		not_empty.notify_all();
+		not_full.notify_all();
+	}
+
+private:
+	const std::size_t capacity;
+	bool closed = false;
+	std::deque<T> items;
+	std::mutex mutex;
+	std::condition_variable not_full;
+	std::condition_variable not_empty;
+};
+
+/**
+ * Instances of T that several threads share, for objects keeping
+ * state while in use (like hfst lookup). A thread takes one for as
+ * long as it holds the Lease. If none is free, it waits for one; and
+ * if that happens, a new instance is made with make (from the one it
+ * got, which no one else is using meanwhile), up to max instances
+ * (one until setMax says more threads may use the pool). So there are
+ * only ever as many as there are threads wanting one at the same
+ * time, and single-threaded use makes none.
+ */
+template<typename T> class Pool {
+public:
+	using Make = std::function<std::unique_ptr<T>(T& idle)>;
+
+	Pool(std::unique_ptr<T> first, Make make_)
+	  : make(std::move(make_)) {
+		idle.push_back(first.get());
+		instances.push_back(std::move(first));
+	}
+	Pool(Pool const&) = delete;
+	Pool& operator=(Pool const&) = delete;
+
+	// Make no more than max instances from now on (those already made
+	// are kept)
+	void setMax(std::size_t max_) {
+		std::lock_guard<std::mutex> lock(mutex);
+		max = std::max<std::size_t>(1, max_);
+	}
+
+	class Lease {
+	public:
+		Lease(Pool& pool_, T* t_)
+		  : pool(&pool_)
+		  , t(t_) {}
+		Lease(Lease&& other)
+		  : pool(other.pool)
+		  , t(other.t) {
+			other.t = nullptr;
+		}
+		Lease(Lease const&) = delete;
+		Lease& operator=(Lease const&) = delete;
+		~Lease() {
+			if (t != nullptr) {
+				pool->give(t);
+			}
+		}
+		T& operator*() const { return *t; }
+		T* operator->() const { return t; }
+
+	private:
+		Pool* pool;
+		T* t;
+	};
+
+	Lease take() {
+		std::unique_lock<std::mutex> lock(mutex);
+		const bool waited = idle.empty();
+		available.wait(lock, [this] { return !idle.empty(); });
+		T* t = idle.back();
+		idle.pop_back();
+		if (!waited || instances.size() + making >= max) {
+			return Lease(*this, t);
+		}
+		++making;
+		lock.unlock();
+		std::unique_ptr<T> made;
+		try {
+			made = make(*t);
+		}
+		catch (...) {
+			lock.lock();
+			--making;
+			lock.unlock();
+			give(t);
+			throw;
+		}
+		lock.lock();
+		--making;
+		instances.push_back(std::move(made));
+		T* mine = instances.back().get();
+		lock.unlock();
+		give(t);
+		return Lease(*this, mine);
+	}
+
+private:
+	const Make make;
+	std::size_t max = 1;
+	std::vector<std::unique_ptr<T>> instances;
+	std::vector<T*> idle;
+	std::size_t making = 0;
+	std::mutex mutex;
+	std::condition_variable available;
+
+	void give(T* t) {
+		std::lock_guard<std::mutex> lock(mutex);
+		idle.push_back(t);
+		available.notify_one();
+	}
+};
+
+}
+
+#endif
@@ -0,0 +1,32 @@
+#!/bin/bash
+
+if test -z "$srcdir" ; then
+    echo run this from make check or set srcdir=.
+    exit 1
+fi
+
+set -e -u
+
+# Programs that just echo their input (and each flush) shouldn't change
+# the output:
+builddir=$(pwd) out=xml-sh "$srcdir"/run xml -s pipespec.xml -n smegram-sh
+
+set -x
+# A program that exits in the middle of a request fails that request,
+# and is started again for the next one:
+printf 'a 3\nok1\nb 3\ndie\nc 3\nok2\n' \
+    | ../../src/divvun-checker -s pipespec.xml -n sh-exits --server -j 1 > output.sh-exits.txt
+grep -q '^a ok ' output.sh-exits.txt
+grep -q '^b error ' output.sh-exits.txt
+grep -q '^c ok ' output.sh-exits.txt
+
+# A program that doesn't exit when its input ends is killed, instead of
+# keeping us from exiting:
+echo x | timeout 10 ../../src/divvun-checker -s pipespec.xml -n sh-ignores-eof > output.sh-ignores-eof.txt
+grep -q '^x$' output.sh-ignores-eof.txt
+
+# A program that never answers is killed after its timeout:
+if echo x | timeout 30 ../../src/divvun-checker -s pipespec.xml -n sh-timeout 2> output.sh-timeout.txt; then
+    exit 1
+fi
+grep -q 'sleep gave no output' output.sh-timeout.txt
@@ -0,0 +1,96 @@
+/*
+* Copyright (C) 2026, Kevin Brubeck Unhammer <unhammer@fsfe.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Check that clones of a Checker give the same errors as the
+// original when run at the same time, from several threads
+
+
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+// divvun-gramcheck:
+#include "checker.hpp"
+
+using divvun::Err;
+
+bool same(const std::vector<Err>& a, const std::vector<Err>& b) {
+	if (a.size() != b.size()) {
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); ++i) {
+		if (a[i].form != b[i].form || a[i].beg != b[i].beg ||
+		    a[i].end != b[i].end || a[i].err != b[i].err ||
+		    a[i].msg != b[i].msg || a[i].rep != b[i].rep) {
+			return false;
+		}
+	}
+	return true;
+}
+
+int main() {
+	const char* srcdir = std::getenv("srcdir");
+	std::ifstream in(std::string(srcdir ? srcdir : ".") + "/input.archive.txt");
+	std::stringstream text;
+	text << in.rdbuf();
+
+	divvun::ArCheckerSpec spec("sme.zcheck");
+	auto checker = spec.getChecker("smegram-nospell", false);
+	std::stringstream first(text.str());
+	const auto want = checker->proc_errs(first);
+	if (want.empty()) {
+		std::cerr << "test-clones: expected some errors in input.archive.txt"
+		          << std::endl;
+		return EXIT_FAILURE;
+	}
+
+	const size_t threads = 4;
+	const size_t rounds = 50;
+	std::vector<std::unique_ptr<divvun::Checker>> clones;
+	for (size_t i = 0; i < threads; ++i) {
+		clones.push_back(checker->clone());
+	}
+	std::atomic<size_t> wrong(0);
+	std::vector<std::thread> running;
+	for (auto& clone : clones) {
+		divvun::Checker* c = clone.get();
+		running.emplace_back([&, c] {
+			for (size_t r = 0; r < rounds; ++r) {
+				std::stringstream input(text.str());
+				if (!same(c->proc_errs(input), want)) {
+					++wrong;
+				}
+			}
+		});
+	}
+	for (auto& t : running) {
+		t.join();
+	}
+	if (wrong > 0) {
+		std::cerr << "test-clones: " << wrong << " of " << threads * rounds
+		          << " runs on clones gave other errors than the original"
+		          << std::endl;
+		return EXIT_FAILURE;
+	}
+	return EXIT_SUCCESS;
+}
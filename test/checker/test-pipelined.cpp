@@ -0,0 +1,72 @@
+/*
+* Copyright (C) 2026, Kevin Brubeck Unhammer <unhammer@fsfe.org>
+*
+* This program is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* This program is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+// Check that a pipelined Checker gives the same output as a
+// sequential one for \0-separated texts
+
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+// divvun-gramcheck:
+#include "checker.hpp"
+
+std::string proc(divvun::Checker& checker, const std::string& text) {
+	std::stringstream input(text);
+	std::stringstream output;
+	checker.proc(input, output);
+	return output.str();
+}
+
+int main() {
+	const char* srcdir = std::getenv("srcdir");
+	std::ifstream in(std::string(srcdir ? srcdir : ".") + "/input.archive.txt");
+	std::stringstream text;
+	text << in.rdbuf();
+	const std::string one = text.str();
+	const std::string two = "ja seammas ballat ođđa dieđuiguin";
+	const std::string nul(1, '\0');
+
+	divvun::ArCheckerSpec spec("sme.zcheck");
+	auto checker = spec.getChecker("smegram-nospell", false);
+	int failed = 0;
+	for (const std::string& texts : { one, one + nul + two,
+	       one + nul + two + nul, nul + one, one + nul + nul + two }) {
+		checker->setPipelined(false);
+		const std::string want = proc(*checker, texts);
+		checker->setPipelined(true);
+		const std::string got = proc(*checker, texts);
+		if (got != want) {
+			std::cerr << "test-pipelined: for input\n"
+			          << texts << "\nsequential gave\n"
+			          << want << "\nbut pipelined gave\n"
+			          << got << std::endl;
+			++failed;
+		}
+		if (texts.back() == '\0' && (want.empty() || want.back() != '\0')) {
+			std::cerr << "test-pipelined: output after the final \\0 of\n"
+			          << texts << "\n:\n"
+			          << want << std::endl;
+			++failed;
+		}
+	}
+	return failed == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
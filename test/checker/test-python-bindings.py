@@ -1,5 +1,7 @@
 #!/usr/bin/python3
 
+import gc
+import json
 import libdivvun
 
 spec = libdivvun.ArCheckerSpec("sme.zcheck")
@@ -22,6 +24,82 @@ for _ in range(1, 10):
     test(errs[0].err, "msyn-valency-loc-com")
     test(errs[0].rep, ('diehtukorrekt',))
 
+gen = smegram.generationCacheStats()
+test(gen.misses > 0, True)
+test(gen.hits >= 8 * gen.misses, True)
+
 inp2 = "Čoahkkinjoiheaddji gohčču"
 errs2 = libdivvun.proc_errs_bytes(smegram, inp2)
 test(errs2[0].rep, ('Čoahkkinjođiheaddji',))
+
+smegram.setThreads(3)
+batch = libdivvun.proc_errs_batch_bytes(smegram, [inp, inp2] * 5)
+test(len(batch), 10)
+for i, errs in enumerate(batch):
+    if i % 2 == 0:
+        test(errs[0].form, 'dieđuiguin')
+        test(errs[0].beg, 23)
+        test(errs[0].rep, ('diehtukorrekt',))
+    else:
+        test(errs[0].rep, ('Čoahkkinjođiheaddji',))
+
+smegram.setProfile(True)
+libdivvun.proc_errs_batch_bytes(smegram, [inp, inp2] * 5)
+stats = smegram.stats()
+test(stats[0].name, 'tokenize tokeniser.pmhfst')
+test(stats[-1].name.split(' ')[0], 'suggest')
+for st in stats:
+    test(st.calls, 10)
+smegram.resetStats()
+test(smegram.stats()[0].calls, 0)
+
+smegram.setTraceOut("output.trace.json")
+libdivvun.proc_errs_bytes(smegram, inp)
+smegram.setTraceOut("")
+with open("output.trace.json") as f:
+    trace = json.load(f)
+test([e["name"] for e in trace][-2:], ['suggest generator.hfstol', 'request'])
+test(set(e["args"]["request"] for e in trace), {1})
+
+smegram.setCacheSize(1 << 20)
+cached = [libdivvun.proc_errs_bytes(smegram, inp) for _ in range(2)]
+test(cached[1][0].rep, cached[0][0].rep)
+test(cached[1][0].beg, 23)
+cache = smegram.cacheStats()
+test((cache.hits, cache.misses, cache.entries), (1, 1, 1))
+smegram.setCacheSize(0)
+test(smegram.cacheStats().entries, 0)
+
+
+def same_errs(got, want):
+    test([(e.form, e.beg, e.end, e.err, e.rep) for e in got],
+         [(e.form, e.beg, e.end, e.err, e.rep) for e in want])
+
+
+doc = libdivvun.document_bytes(smegram, inp + ". " + inp2)
+same_errs(libdivvun.document_errs_bytes(doc),
+          libdivvun.proc_errs_bytes(smegram, inp + ". " + inp2))
+smegram.resetStats()
+doc.edit(len(inp) + 2, 0, "Ja " + inp + ". ")
+test(libdivvun.document_text_bytes(doc), inp + ". Ja " + inp + ". " + inp2)
+test(smegram.stats()[0].calls, 1)  # only the new sentence is checked
+same_errs(libdivvun.document_errs_bytes(doc),
+          libdivvun.proc_errs_bytes(smegram, libdivvun.document_text_bytes(doc)))
+
+# The document keeps its checker alive:
+doc = libdivvun.document_bytes(
+    spec.getChecker(pipename="smegram", verbose=False), "😀 " + inp)
+gc.collect()
+# Offsets are UTF-16, so the emoji counts as two:
+test(libdivvun.document_errs_bytes(doc)[0].beg, 3 + 23)
+doc.edit(3, 0, "Ja ")
+test(libdivvun.document_text_bytes(doc), "😀 Ja " + inp)
+test(libdivvun.document_errs_bytes(doc)[0].beg, 3 + 3 + 23)
+del doc
+
+long_text = ". ".join([inp, inp2] * 5)
+smegram.setChunkSize(40)
+chunked = libdivvun.proc_errs_bytes(smegram, long_text)
+smegram.setChunkSize(0)
+same_errs(chunked, libdivvun.proc_errs_bytes(smegram, long_text))
+test(len(chunked), 10)